@@ -0,0 +1,120 @@
+// AMS Cache - content-addressed output cache
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <filesystem>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "AMS_Cache.hpp"
+#include "AMS_Source.hpp"
+#include "AMS_Util.hpp"
+
+static void appendHex(std::string& out, uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        out += digits[(value >> shift) & 0xF];
+    }
+}
+
+std::string CompileCache::sourceKey(const std::string& filename) {
+    SourceFile source;
+    if (!source.open(filename)) return "";
+    return sourceKey(source);
+}
+
+std::string CompileCache::sourceKey(const SourceFile& source) {
+    std::string normalised;
+    normalised.reserve(source.size());
+    for (size_t i = 0; i < source.lineCount(); i++) {
+        normalised += source.line(i);
+        normalised += '\n';
+    }
+
+    // Two independently seeded lanes give a 128-bit key
+    std::string salt = std::string(AMS_CONVERTER_VERSION) + "/" + std::to_string(AMS_OUTPUT_REVISION);
+    uint64_t seed = hashBytes(salt);
+    std::string key;
+    appendHex(key, hashBytes(normalised, seed));
+    appendHex(key, hashBytes(normalised, ~seed));
+    return key;
+}
+
+std::string CompileCache::entryPath(const std::string& key, OutputFormat format) const {
+    return dir + "/" + key.substr(0, 2) + "/" + key.substr(2) + "." + formatKey(format);
+}
+
+bool CompileCache::load(const std::string& key, OutputFormat format, std::string& data) const {
+    std::ifstream file(entryPath(key, format), std::ios::binary);
+    if (!file.is_open()) return false;
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+bool CompileCache::store(const std::string& key, OutputFormat format, const std::string& data) const {
+    std::string path = entryPath(key, format);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    return writeFileAtomic(path, data);
+}
+
+bool CompileCache::storeFile(const std::string& key, OutputFormat format, const std::string& source) const {
+    std::string path = entryPath(key, format);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    return copyFileAtomic(source, path);
+}
+
+// Unique per process and per call, so racing writers never share a temp file
+static std::string tempPath(const std::string& path) {
+    static std::atomic<unsigned long> counter(0);
+    std::string temp = path + ".tmp";
+#if !defined(_WIN32)
+    temp += "." + std::to_string(::getpid());
+#endif
+    temp += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000);
+    temp += "." + std::to_string(counter++);
+    return temp;
+}
+
+static bool renameOver(const std::string& temp, const std::string& path) {
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool writeFileAtomic(const std::string& path, const std::string& data) {
+    std::string temp = tempPath(path);
+    {
+        std::ofstream file(temp, std::ios::binary);
+        if (!file.is_open()) return false;
+        file << data;
+        file.close();
+        if (!file) {
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+    return renameOver(temp, path);
+}
+
+bool copyFileAtomic(const std::string& source, const std::string& path) {
+    std::string temp = tempPath(path);
+    std::error_code ec;
+    if (!std::filesystem::copy_file(source, temp, std::filesystem::copy_options::overwrite_existing, ec)) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return renameOver(temp, path);
+}
@@ -0,0 +1,58 @@
+#ifndef AMS_CACHE_HPP
+#define AMS_CACHE_HPP
+
+// AMS Cache - content-addressed store for converter outputs
+//
+// An entry is keyed on a 128-bit hash of the normalised source (every
+// line with its // comment and surrounding whitespace removed, which is
+// all the parser ever looks at), the converter version and the output
+// format. Entries live at <dir>/<2 hex>/<30 hex>.<format>, so a hit needs no
+// parse and no emission: the stored bytes are copied to the output.
+//
+// Entries are written to a temporary file in the same directory and
+// renamed into place, so concurrent batch workers (or processes) sharing
+// one cache never see a partial entry.
+
+#include <string>
+
+#include "AMS_Driver.hpp"
+
+class SourceFile;
+
+// Part of every cache key. Bump AMS_OUTPUT_REVISION whenever the bytes an
+// emitter produces for the same source change, so stale entries miss.
+const char* const AMS_CONVERTER_VERSION = "3.0-Beta";
+const int AMS_OUTPUT_REVISION = 5;
+
+class CompileCache {
+private:
+    std::string dir;
+
+public:
+    explicit CompileCache(const std::string& dir) : dir(dir) {}
+
+    // Hex key for the normalised contents of `filename`, empty if the file
+    // cannot be read.
+    static std::string sourceKey(const std::string& filename);
+
+    // Key for a source that is already loaded. Outputs are stored under the
+    // key of the text they were parsed from, whatever the file holds now.
+    static std::string sourceKey(const SourceFile& source);
+
+    std::string entryPath(const std::string& key, OutputFormat format) const;
+
+    bool load(const std::string& key, OutputFormat format, std::string& data) const;
+    bool store(const std::string& key, OutputFormat format, const std::string& data) const;
+
+    // Stores a copy of the output file `source`, which was just written
+    bool storeFile(const std::string& key, OutputFormat format, const std::string& source) const;
+};
+
+// Writes `data` to a temporary file next to `path` and renames it over
+// `path`. Returns false (leaving `path` untouched) on any failure.
+bool writeFileAtomic(const std::string& path, const std::string& data);
+
+// Same, copying the contents of the file `source`
+bool copyFileAtomic(const std::string& source, const std::string& path);
+
+#endif
@@ -0,0 +1,461 @@
+// AMS Driver - multi-target and batch compilation
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <set>
+#include <functional>
+#include <system_error>
+#include <algorithm>
+#include <filesystem>
+#include <charconv>
+
+#if !defined(_WIN32)
+#include <glob.h>
+#endif
+
+#include "AMS_Driver.hpp"
+#include "AMS_Cache.hpp"
+#include "AMS_Parser.hpp"
+#include "AMS_JSON.hpp"
+#include "AMS_TOML.hpp"
+#include "AMS_MIDI.hpp"
+#include "AMS_Parallel.hpp"
+#include "AMS_Util.hpp"
+
+// ============================================
+// Formats
+// ============================================
+bool parseFormatList(const std::string& list, std::vector<OutputFormat>& formats) {
+    formats.clear();
+    for (const auto& name : split(list, ',')) {
+        if (name == "json") formats.push_back(OutputFormat::JSON);
+        else if (name == "json-min") formats.push_back(OutputFormat::JSON_MIN);
+        else if (name == "ndjson") formats.push_back(OutputFormat::NDJSON);
+        else if (name == "toml") formats.push_back(OutputFormat::TOML);
+        else if (name == "toml-compact") formats.push_back(OutputFormat::TOML_COMPACT);
+        else if (name == "midi" || name == "mid") formats.push_back(OutputFormat::MIDI);
+        else return false;
+    }
+
+    // Two layouts of one format would write the same file
+    for (size_t i = 0; i < formats.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (formats[i] != formats[j] &&
+                std::string_view(formatExtension(formats[i])) == formatExtension(formats[j])) {
+                return false;
+            }
+        }
+    }
+    return !formats.empty();
+}
+
+const char* formatName(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::JSON: return "JSON";
+        case OutputFormat::JSON_MIN: return "JSON (minified)";
+        case OutputFormat::NDJSON: return "NDJSON";
+        case OutputFormat::TOML: return "TOML";
+        case OutputFormat::TOML_COMPACT: return "TOML (compact)";
+        default: return "MIDI";
+    }
+}
+
+const char* formatKey(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::JSON: return "json";
+        case OutputFormat::JSON_MIN: return "json-min";
+        case OutputFormat::NDJSON: return "ndjson";
+        case OutputFormat::TOML: return "toml";
+        case OutputFormat::TOML_COMPACT: return "toml-compact";
+        default: return "midi";
+    }
+}
+
+const char* formatExtension(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::JSON:
+        case OutputFormat::JSON_MIN: return ".json";
+        case OutputFormat::NDJSON: return ".ndjson";
+        case OutputFormat::TOML:
+        case OutputFormat::TOML_COMPACT: return ".toml";
+        default: return ".mid";
+    }
+}
+
+void emitFormat(const Score& score, OutputFormat format, OutputSink& out, unsigned workers) {
+    switch (format) {
+        case OutputFormat::JSON: writeJSON(score, out, JSONLayout::PRETTY, workers); break;
+        case OutputFormat::JSON_MIN: writeJSON(score, out, JSONLayout::MINIFIED, workers); break;
+        case OutputFormat::NDJSON: writeNDJSON(score, out); break;
+        case OutputFormat::TOML: writeTOML(score, out, TOMLLayout::FULL, workers); break;
+        case OutputFormat::TOML_COMPACT: writeTOML(score, out, TOMLLayout::COMPACT, workers); break;
+        default: out.write(scoreToMIDI(score)); break;
+    }
+}
+
+std::string emitFormat(const Score& score, OutputFormat format, unsigned workers) {
+    std::string output;
+    {
+        OutputSink out(output);
+        emitFormat(score, format, out, workers);
+    }
+    return output;
+}
+
+// ============================================
+// Emission
+// ============================================
+static bool writeOutput(const std::string& filename, const std::string& output) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    file << output;
+    file.close();
+    return static_cast<bool>(file);
+}
+
+// Emits straight into `filename` through the sink's buffer
+static bool emitToFile(const Score& score, OutputFormat format, const std::string& filename, unsigned workers) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    OutputSink out(file);
+    emitFormat(score, format, out, workers);
+    if (!out.flush()) return false;
+    file.close();
+    return static_cast<bool>(file);
+}
+
+static std::vector<TargetResult> makeTargets(const std::string& filename, const std::vector<OutputFormat>& formats) {
+    std::vector<TargetResult> results;
+    for (OutputFormat format : formats) {
+        TargetResult result;
+        result.format = format;
+        result.filename = replaceExtension(filename, formatExtension(format));
+        result.written = false;
+        results.push_back(result);
+    }
+    return results;
+}
+
+// Nothing may escape a worker thread: an emitter that throws leaves the
+// target unwritten, and it is reported like any failed write.
+static void emitTarget(const Score& score, TargetResult& result, const CompileCache* cache, const std::string& key,
+                       unsigned workers) {
+    try {
+        result.written = emitToFile(score, result.format, result.filename, workers);
+        if (cache && result.written) cache->storeFile(key, result.format, result.filename);
+    } catch (...) {
+        result.written = false;
+    }
+}
+
+std::vector<TargetResult> emitTargets(const Score& score, const std::string& filename,
+                                      const std::vector<OutputFormat>& formats,
+                                      const CompileCache* cache, const std::string& key, unsigned workers) {
+    std::vector<TargetResult> results = makeTargets(filename, formats);
+
+    // The emitters share the thread budget rather than each taking all of it
+    unsigned budget = workers ? workers : defaultWorkerCount();
+    unsigned per_target = std::max(1u, budget / static_cast<unsigned>(std::max<size_t>(results.size(), 1)));
+
+    // The first target runs on the calling thread, the rest on their own.
+    // Each worker only reads the Score and writes its own result slot.
+    // A target whose thread cannot be started runs here instead.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < results.size(); i++) {
+        try {
+            threads.emplace_back(emitTarget, std::cref(score), std::ref(results[i]), cache, std::cref(key), per_target);
+        } catch (const std::system_error&) {
+            emitTarget(score, results[i], cache, key, per_target);
+        }
+    }
+    if (!results.empty()) emitTarget(score, results[0], cache, key, per_target);
+    for (auto& thread : threads) thread.join();
+
+    return results;
+}
+
+// Writes every target straight from the cache. Returns false without
+// writing anything unless every format is cached.
+static bool restoreTargets(const CompileCache& cache, const std::string& key, std::vector<TargetResult>& results) {
+    std::vector<std::string> outputs(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!cache.load(key, results[i].format, outputs[i])) return false;
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        results[i].written = writeOutput(results[i].filename, outputs[i]);
+    }
+    return true;
+}
+
+int compileTargets(const std::string& filename, const std::vector<OutputFormat>& formats,
+                   const std::string& cache_dir) {
+    std::cout << "Compiling: " << filename << "\n\n";
+
+    CompileCache cache(cache_dir);
+    std::string key = cache_dir.empty() ? "" : CompileCache::sourceKey(filename);
+
+    std::vector<TargetResult> results = makeTargets(filename, formats);
+    if (!key.empty() && restoreTargets(cache, key, results)) {
+        std::cout << "✓ Cache hit, nothing to compile\n\n";
+    } else {
+        AMSParser parser(filename);
+        parser.setFastPath(true);
+        if (!parser.parse()) {
+            parser.printErrors();
+            return 1;
+        }
+
+        std::cout << "✓ Compilation successful!\n\n";
+
+        // The file may have changed since the lookup; outputs are stored
+        // under the key of the text they were parsed from
+        if (!key.empty()) key = CompileCache::sourceKey(parser.getSource());
+        results = emitTargets(parser.getScore(), filename, formats, key.empty() ? nullptr : &cache, key);
+    }
+
+    int status = 0;
+    for (const auto& result : results) {
+        if (result.written) {
+            std::cout << "✓ " << formatName(result.format) << " output written to: " << result.filename << "\n";
+        } else {
+            std::cerr << "✗ ERROR: Could not write to file: " << result.filename << std::endl;
+            status = 1;
+        }
+    }
+    std::cout << "\n";
+    return status;
+}
+
+// ============================================
+// Command Line
+// ============================================
+bool parseDriverOptions(int argc, char* argv[], DriverOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--formats") {
+            if (++i >= argc || !parseFormatList(argv[i], options.formats)) return false;
+        } else if (arg == "--batch") {
+            options.batch = true;
+        } else if (arg == "--cache") {
+            if (++i >= argc) return false;
+            options.cache_dir = argv[i];
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg == "--jobs") {
+            if (++i >= argc) return false;
+            std::string_view value(argv[i]);
+            unsigned jobs = 0;
+            std::from_chars_result res = std::from_chars(value.data(), value.data() + value.size(), jobs);
+            if (res.ec != std::errc() || res.ptr != value.data() + value.size() || jobs == 0) return false;
+            options.jobs = jobs;
+        } else if (startsWith(arg, "--")) {
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.inputs.empty() || (options.batch && options.watch)) return false;
+
+    // Watch mode always re-parses; it never reads or fills the cache
+    if (options.watch && !options.cache_dir.empty()) return false;
+    return options.batch || options.watch || options.inputs.size() == 1;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--formats json,json-min,ndjson,toml,toml-compact,midi] [--cache DIR] <input.ams>\n";
+    std::cerr << "       " << program << " --batch [--jobs N] [--formats json,json-min,ndjson,toml,toml-compact,midi] [--cache DIR] <file|dir|glob|@list>...\n";
+    std::cerr << "       " << program << " --watch [--formats json,json-min,ndjson,toml,toml-compact,midi] <file|dir|glob|@list>..." << std::endl;
+}
+
+// ============================================
+// Batch
+// ============================================
+static void addDirectory(const std::string& dir, std::vector<std::string>& files) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> found;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && it->path().extension() == ".ams") {
+            found.push_back(it->path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
+
+static void addPattern(const std::string& pattern, std::vector<std::string>& files) {
+#if !defined(_WIN32)
+    glob_t matches;
+    if (::glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+            files.push_back(matches.gl_pathv[i]);
+        }
+    }
+    ::globfree(&matches);
+#else
+    files.push_back(pattern);
+#endif
+}
+
+static void addPath(const std::string& path, std::vector<std::string>& files) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        addDirectory(path, files);
+    } else if (path.find_first_of("*?[") != std::string::npos) {
+        addPattern(path, files);
+    } else {
+        // Missing files are kept so they are reported in order
+        files.push_back(path);
+    }
+}
+
+std::vector<std::string> expandInputs(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        if (startsWith(input, "@")) {
+            std::ifstream list(input.substr(1));
+            if (!list.is_open()) {
+                files.push_back(input);
+                continue;
+            }
+            std::string line;
+            while (std::getline(list, line)) {
+                std::string path = trim(line);
+                if (!path.empty()) addPath(path, files);
+            }
+        } else {
+            addPath(input, files);
+        }
+    }
+
+    // A file named twice would have two workers writing the same outputs.
+    // Paths are compared resolved, so ./a.ams, a.ams and dir/../a.ams match.
+    std::vector<std::string> unique;
+    std::set<std::string> seen;
+    for (auto& file : files) {
+        std::error_code ec;
+        std::filesystem::path resolved = std::filesystem::weakly_canonical(file, ec);
+        if (seen.insert(ec ? file : resolved.string()).second) unique.push_back(std::move(file));
+    }
+    return unique;
+}
+
+struct BatchReport {
+    bool success;
+    std::string out;  // printed to std::cout
+    std::string err;  // printed to std::cerr
+};
+
+static BatchReport compileOne(const std::string& filename, const std::vector<OutputFormat>& formats,
+                              const CompileCache* cache, unsigned workers_per_file) {
+    BatchReport report;
+    report.success = false;
+    std::ostringstream out, err;
+
+    try {
+        std::string key = cache ? CompileCache::sourceKey(filename) : "";
+        std::vector<TargetResult> cached = makeTargets(filename, formats);
+        if (!key.empty() && restoreTargets(*cache, key, cached)) {
+            report.success = true;
+            out << "✓ " << filename << " (cached)\n";
+            for (const auto& result : cached) {
+                if (result.written) {
+                    out << "    " << formatName(result.format) << " output written to: " << result.filename << "\n";
+                } else {
+                    err << "✗ ERROR: Could not write to file: " << result.filename << "\n";
+                    report.success = false;
+                }
+            }
+            report.out = out.str();
+            report.err = err.str();
+            return report;
+        }
+
+        AMSParser parser(filename);
+        parser.setWorkerCount(workers_per_file);
+        parser.setFastPath(true);
+        if (!parser.parse()) {
+            err << "✗ " << filename << "\n";
+            parser.printErrors(err);
+            err << "\n";
+        } else {
+            report.success = true;
+            out << "✓ " << filename << "\n";
+            if (!key.empty()) key = CompileCache::sourceKey(parser.getSource());
+            for (OutputFormat format : formats) {
+                TargetResult result;
+                result.format = format;
+                result.filename = replaceExtension(filename, formatExtension(format));
+                result.written = false;
+                emitTarget(parser.getScore(), result, key.empty() ? nullptr : cache, key, workers_per_file);
+
+                if (result.written) {
+                    out << "    " << formatName(format) << " output written to: " << result.filename << "\n";
+                } else {
+                    err << "✗ ERROR: Could not write to file: " << result.filename << "\n";
+                    report.success = false;
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        err << "✗ " << filename << ": internal error: " << e.what() << "\n";
+        report.success = false;
+    }
+
+    report.out = out.str();
+    report.err = err.str();
+    return report;
+}
+
+int compileBatch(const std::vector<std::string>& inputs, const std::vector<OutputFormat>& formats, unsigned jobs,
+                 const std::string& cache_dir) {
+    std::vector<std::string> files = expandInputs(inputs);
+    if (files.empty()) {
+        std::cerr << "✗ No .ams files matched the given inputs" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Batch: " << files.size() << " file(s)\n\n";
+
+    CompileCache cache(cache_dir);
+
+    // Files already run in parallel; each parser and emitter only goes wide
+    // when there is a single file or a single job.
+    unsigned pool = jobs ? jobs : defaultWorkerCount();
+    unsigned workers_per_file = (pool > 1 && files.size() > 1) ? 1 : 0;
+
+    // Reports are flushed strictly in input order: a finished file waits
+    // until every earlier one has been printed.
+    std::vector<BatchReport> reports(files.size());
+    std::vector<bool> done(files.size(), false);
+    size_t next_to_print = 0;
+    size_t failed = 0;
+    std::mutex print_mutex;
+
+    parallelFor(files.size(), jobs, [&](size_t i) {
+        BatchReport report = compileOne(files[i], formats, cache_dir.empty() ? nullptr : &cache, workers_per_file);
+
+        std::lock_guard<std::mutex> lock(print_mutex);
+        reports[i] = std::move(report);
+        done[i] = true;
+        while (next_to_print < files.size() && done[next_to_print]) {
+            BatchReport& ready = reports[next_to_print];
+            std::cout << ready.out << std::flush;
+            std::cerr << ready.err << std::flush;
+            if (!ready.success) failed++;
+            ready = BatchReport();
+            next_to_print++;
+        }
+    });
+
+    std::cout << "\nBatch complete: " << files.size() - failed << " succeeded, " << failed << " failed\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#ifndef AMS_DRIVER_HPP
+#define AMS_DRIVER_HPP
+
+// AMS Driver - command line handling shared by the converters
+//
+// Multi-target: the file is parsed once; every requested emitter then runs
+// on its own thread over the same read-only Score and writes its artifact
+// next to the input (replaceExtension(filename, ".json" | ".toml" | ".mid")).
+//
+// Batch: files, directories, globs and @list files are expanded into one
+// ordered input list and compiled on a work-stealing pool. Each file's
+// report is printed in input order as soon as every earlier file is done.
+//
+// Watch: see AMS_Watch.hpp.
+//
+// Cache: with --cache DIR, single-file and batch compiles look every
+// output up in a content-addressed cache first (see AMS_Cache.hpp). A
+// file whose outputs are all cached is neither parsed nor emitted.
+
+#include <string>
+#include <vector>
+
+#include "AMS_IR.hpp"
+#include "AMS_Output.hpp"
+
+// JSON_MIN, NDJSON and TOML_COMPACT are the minified JSON, note event
+// stream and compact TOML layouts (see AMS_JSON.hpp and AMS_TOML.hpp)
+enum class OutputFormat { JSON, JSON_MIN, NDJSON, TOML, TOML_COMPACT, MIDI };
+
+class CompileCache;
+
+struct TargetResult {
+    OutputFormat format;
+    std::string filename;
+    bool written;
+};
+
+// Parses "json,toml,midi" (any order, "mid" is accepted for MIDI, and
+// "json-min", "ndjson" and "toml-compact" for the other layouts). Returns false on an unknown or empty
+// format name, or two formats that would write the same file.
+bool parseFormatList(const std::string& list, std::vector<OutputFormat>& formats);
+
+const char* formatName(OutputFormat format);
+const char* formatKey(OutputFormat format);  // its name in --formats
+const char* formatExtension(OutputFormat format);
+
+// Streams one format into `out`; the string overload collects it instead.
+// JSON and TOML segments are rendered on up to `workers` threads.
+void emitFormat(const Score& score, OutputFormat format, OutputSink& out, unsigned workers = 1);
+std::string emitFormat(const Score& score, OutputFormat format, unsigned workers = 1);
+
+// Runs the emitters concurrently, each streaming into its output file.
+// Results are returned in the order of `formats`. With a cache, every
+// output written is also copied into it under `key`. The emitters split
+// `workers` threads (0: one per hardware thread) between them for their
+// segments, each getting at least one.
+std::vector<TargetResult> emitTargets(const Score& score, const std::string& filename,
+                                      const std::vector<OutputFormat>& formats,
+                                      const CompileCache* cache = nullptr, const std::string& key = "",
+                                      unsigned workers = 0);
+
+// Parse + emitTargets with console reporting. Returns a process exit code.
+// An empty cache_dir disables the cache.
+int compileTargets(const std::string& filename, const std::vector<OutputFormat>& formats,
+                   const std::string& cache_dir = "");
+
+// ============================================
+// Command Line
+// ============================================
+struct DriverOptions {
+    std::vector<OutputFormat> formats;  // empty: the converter's own format
+    std::vector<std::string> inputs;
+    std::string cache_dir;              // empty: no cache
+    bool batch;
+    bool watch;
+    unsigned jobs;                      // 0: one per hardware thread
+
+    DriverOptions() : batch(false), watch(false), jobs(0) {}
+};
+
+// Returns false on an unknown option, a malformed value, --cache with
+// --watch or a bad input count (exactly one input unless --batch or
+// --watch is given).
+bool parseDriverOptions(int argc, char* argv[], DriverOptions& options);
+
+void printUsage(const char* program);
+
+// Expands directories (recursively, *.ams), glob patterns and @list files
+// (one path per line) into a flat list, keeping the order they were given.
+// Repeated paths are kept once, at their first position.
+std::vector<std::string> expandInputs(const std::vector<std::string>& inputs);
+
+// Compiles every input to every format on `jobs` workers. Returns a
+// process exit code: 0 only if every file compiled and was written.
+int compileBatch(const std::vector<std::string>& inputs, const std::vector<OutputFormat>& formats, unsigned jobs,
+                 const std::string& cache_dir = "");
+
+#endif
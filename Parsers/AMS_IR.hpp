@@ -0,0 +1,156 @@
+#ifndef AMS_IR_HPP
+#define AMS_IR_HPP
+
+// AMS IR - the parse result shared by every emitter
+//
+// AMSParser builds a Score once; the JSON, TOML and MIDI emitters only
+// ever read it through a const reference, so a single parse can feed any
+// number of output formats.
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "AMS_Score.hpp"
+#include "AMS_Pitch.hpp"
+
+// ============================================
+// Error Tracking
+// ============================================
+struct ParseError {
+    int line_number;
+    std::string error_message;
+    std::string error_type;  // "SYNTAX", "SEMANTIC", "LOGIC", etc.
+};
+
+// ============================================
+// Data Structures
+// ============================================
+struct Segment {
+    int id;
+    std::string name;
+    int tempo;
+    Hand left;
+    Hand right;
+    int definition_line;  // Track where it was defined
+};
+
+// A Define block, parsed once. Use(NAME) splices its hand into the hand
+// being parsed; macro boundaries leave no trace in the result.
+struct Macro {
+    std::string name;
+    Hand hand;
+    int definition_line;
+    uint64_t hash;  // the body and every macro it uses; reparse() compares it
+
+    Macro() : definition_line(0), hash(0) {}
+};
+
+struct Metadata {
+    std::string title;
+    std::string composer;
+    std::string key;
+    int tempo;
+    std::string time_signature;
+    int difficulty;
+
+    Metadata() : tempo(120), difficulty(0) {}
+};
+
+struct MapBlock {
+    std::string key;
+    std::string scale;
+    const ScaleTable* table;  // set once the key and scale are validated
+    bool defined;
+    int line_number;
+
+    MapBlock() : table(nullptr), defined(false), line_number(0) {}
+
+    bool hasPitch(int degree) const {
+        return table && degree >= 1 && degree <= 7;
+    }
+
+    // Pitch name for a scale degree, empty if the degree is unmapped
+    const char* pitch(int degree) const {
+        return hasPitch(degree) ? table->names[degree - 1] : "";
+    }
+};
+
+// ============================================
+// Playback Program
+// ============================================
+// Main() compiled into a flat list of steps. A Repeat is a single loop
+// step whose body follows it, so Repeat(1000) { ... } is stored once and
+// only unrolled while it is being played (see forEachPlayed).
+enum class PlayOp : uint8_t { SEGMENT, INLINE, REPEAT };
+
+struct PlayStep {
+    PlayOp op;
+    uint32_t index;  // SEGMENT: into Score::segments, INLINE: into Playback::inline_events
+    uint32_t count;  // REPEAT: times the body is played, at least 1
+    uint32_t end;    // REPEAT: one past the last step of the body
+};
+
+// Consecutive LEFT: and RIGHT: lines of Main(); each hand plays its own notes
+struct InlineEvent {
+    Hand left;
+    Hand right;
+};
+
+struct Playback {
+    std::vector<PlayStep> steps;
+    std::vector<InlineEvent> inline_events;
+};
+
+// Calls fn(step) for every SEGMENT and INLINE step in performance order.
+// Loops are unrolled on the fly, so the walk needs memory for the nesting
+// depth only. Repeat bodies that play nothing are never compiled, so every
+// loop iteration reaches fn at least once.
+template <typename Fn>
+void forEachPlayed(const Playback& playback, Fn fn) {
+    struct Loop {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t remaining;
+    };
+    std::vector<Loop> loops;
+
+    const std::vector<PlayStep>& steps = playback.steps;
+    uint32_t pc = 0;
+    while (true) {
+        if (!loops.empty() && pc == loops.back().end) {
+            if (--loops.back().remaining > 0) {
+                pc = loops.back().begin;
+            } else {
+                loops.pop_back();
+            }
+            continue;
+        }
+        if (pc >= steps.size()) break;
+
+        const PlayStep& step = steps[pc];
+        if (step.op == PlayOp::REPEAT) {
+            loops.push_back({pc + 1, step.end, step.count});
+        } else {
+            fn(step);
+        }
+        pc++;
+    }
+}
+
+struct Score {
+    Metadata metadata;
+    MapBlock map_block;
+    std::vector<Segment> segments;  // in definition order
+    std::vector<Macro> macros;      // complete Define blocks, in definition order
+    Playback playback;              // Main(), in playback order
+};
+
+// Notes of every segment, both hands
+inline size_t segmentNoteCount(const Score& score) {
+    size_t notes = 0;
+    for (const Segment& seg : score.segments) notes += seg.left.noteCount() + seg.right.noteCount();
+    return notes;
+}
+
+#endif
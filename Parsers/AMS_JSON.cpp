@@ -0,0 +1,354 @@
+// AMS JSON - JSON emitter
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "AMS_JSON.hpp"
+
+// ============================================
+// JSON Writer
+// ============================================
+// Writes straight into the sink, pretty-printed with two-space indentation
+// or with no whitespace at all. Only the current depth and whether
+// anything was written at it are kept.
+class JSONWriter {
+private:
+    OutputSink& out;
+    bool pretty;
+    int depth = 0;
+    bool first = true;
+
+    // Separator, newline and indentation before the next member or element
+    void next() {
+        if (depth > 0) {
+            if (!first) out.put(',');
+            if (pretty) {
+                out.put('\n');
+                out.fill(' ', static_cast<size_t>(depth) * 2);
+            }
+        }
+        first = false;
+    }
+
+    void name(std::string_view key) {
+        next();
+        writeString(key);
+        out.write(pretty ? ": " : ":");
+    }
+
+    void writeString(std::string_view value) {
+        static const char HEX[] = "0123456789abcdef";
+        out.put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            out.write(value.substr(start, i - start));
+            switch (c) {
+                case '"': out.write("\\\""); break;
+                case '\\': out.write("\\\\"); break;
+                case '\n': out.write("\\n"); break;
+                case '\t': out.write("\\t"); break;
+                case '\r': out.write("\\r"); break;
+                default:
+                    out.write("\\u00");
+                    out.put(HEX[c >> 4]);
+                    out.put(HEX[c & 0xF]);
+                    break;
+            }
+            start = i + 1;
+        }
+        out.write(value.substr(start));
+        out.put('"');
+    }
+
+    void open(char bracket) {
+        out.put(bracket);
+        depth++;
+        first = true;
+    }
+
+    void close(char bracket) {
+        depth--;
+        if (pretty && !first) {
+            out.put('\n');
+            out.fill(' ', static_cast<size_t>(depth) * 2);
+        }
+        out.put(bracket);
+        first = false;
+    }
+
+public:
+    JSONWriter(OutputSink& out, bool pretty) : out(out), pretty(pretty) {}
+
+    // Continues inside an array or object open at `depth`, after elements
+    // written elsewhere unless `first`
+    JSONWriter(OutputSink& out, bool pretty, int depth, bool first)
+        : out(out), pretty(pretty), depth(depth), first(first) {}
+
+    int level() const { return depth; }
+
+    // Elements were written at this depth by another writer
+    void continueAfter() { first = false; }
+
+    void startObject() {
+        next();
+        open('{');
+    }
+
+    void startObject(std::string_view key) {
+        name(key);
+        open('{');
+    }
+
+    void endObject() { close('}'); }
+
+    void startArray(std::string_view key) {
+        name(key);
+        open('[');
+    }
+
+    void endArray() { close(']'); }
+
+    void addString(std::string_view key, std::string_view value) {
+        name(key);
+        writeString(value);
+    }
+
+    // An array element
+    void addString(std::string_view value) {
+        next();
+        writeString(value);
+    }
+
+    void addNumber(std::string_view key, int value) {
+        name(key);
+        out.writeInt(value);
+    }
+
+    void addNumber(std::string_view key, double value) {
+        name(key);
+        out.writeNumber(value);
+    }
+
+    void addBool(std::string_view key, bool value) {
+        name(key);
+        out.write(value ? "true" : "false");
+    }
+
+    // Ends the document (or, in NDJSON, the record)
+    void finish() { out.put('\n'); }
+};
+
+// ============================================
+// Emitter
+// ============================================
+// With `full` unset (JSONLayout::MINIFIED), members that hold their
+// default are left out.
+static void writeNote(JSONWriter& json, const MapBlock& map_block, const Note& note, bool full) {
+    json.startObject();
+    if (full || note.is_rest) json.addBool("isRest", note.is_rest);
+
+    if (!note.is_rest && note.degree > 0) {
+        json.addNumber("degree", note.degree);
+        if (full || note.accidental != Accidental::NONE) json.addString("accidental", accidentalText(note.accidental));
+        if (full || note.octave_shift != 0) json.addNumber("octaveShift", note.octave_shift);
+        json.addString("pitch", map_block.pitch(note.degree));
+    }
+
+    // Always the chord's
+    if (full) {
+        json.addNumber("duration", ticksToBeats(note.ticks));
+        json.addBool("isDotted", note.is_dotted);
+    }
+    if (full || note.articulation != Articulation::NONE) {
+        json.addString("articulation", articulationText(note.articulation));
+    }
+    if (full || note.dynamic != Dynamic::NONE) json.addString("dynamic", dynamicText(note.dynamic));
+    json.endObject();
+}
+
+static void writeChord(JSONWriter& json, const MapBlock& map_block, const Hand& hand, size_t chord, bool full) {
+    json.startObject();
+    json.addNumber("duration", ticksToBeats(hand.ticks[chord]));
+    if (full || hand.dotted[chord]) json.addBool("isDotted", hand.dotted[chord] != 0);
+
+    json.startArray("notes");
+    for (size_t n = hand.chord_starts[chord]; n < hand.chord_starts[chord + 1]; n++) {
+        writeNote(json, map_block, hand.note(chord, n), full);
+    }
+    json.endArray();
+    json.endObject();
+}
+
+static void writeHand(JSONWriter& json, const char* key, const MapBlock& map_block, const Hand& hand, bool full) {
+    json.startObject(key);
+    json.startArray("chunks");
+    for (size_t k = 0; k < hand.chunkCount(); k++) {
+        json.startObject();
+        json.startArray("chords");
+        for (size_t c = hand.chunk_starts[k]; c < hand.chunk_starts[k + 1]; c++) {
+            writeChord(json, map_block, hand, c, full);
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+static void writeSegment(JSONWriter& json, const MapBlock& map_block, const Segment& seg, bool full) {
+    json.startObject();
+    json.addNumber("id", seg.id);
+    json.addString("name", seg.name);
+    json.addNumber("tempo", seg.tempo);
+    writeHand(json, "left", map_block, seg.left, full);
+    writeHand(json, "right", map_block, seg.right, full);
+    json.endObject();
+}
+
+void writeJSON(const Score& score, OutputSink& out, JSONLayout layout, unsigned workers) {
+    const Metadata& metadata = score.metadata;
+    const MapBlock& map_block = score.map_block;
+    bool full = layout == JSONLayout::PRETTY;
+
+    JSONWriter json(out, full);
+    json.startObject();
+
+    // Metadata
+    json.addString("version", "3.0-Beta");
+    json.addString("title", metadata.title);
+    json.addString("composer", metadata.composer);
+    json.addString("key", metadata.key);
+    json.addNumber("tempo", metadata.tempo);
+    json.addString("timeSignature", metadata.time_signature);
+    json.addNumber("difficulty", metadata.difficulty);
+
+    // Map
+    json.startArray("map");
+    json.startObject();
+    json.addString("key", map_block.key);
+    json.addString("scale", map_block.scale);
+    json.startArray("noteMapping");
+    for (int i = 1; i <= 7; i++) {
+        json.addString(map_block.pitch(i));
+    }
+    json.endArray();
+    json.endObject();
+    json.endArray();
+
+    // Segments, each on its own writer so they can be written in parallel
+    json.startArray("segments");
+    if (segmentNoteCount(score) < PARALLEL_EMIT_MIN_NOTES) workers = 1;
+    int depth = json.level();
+    writeOrdered(out, score.segments.size(), workers, [&](size_t i, OutputSink& sink) {
+        JSONWriter part(sink, full, depth, i == 0);
+        writeSegment(part, map_block, score.segments[i], full);
+    });
+    if (!score.segments.empty()) json.continueAfter();
+    json.endArray();
+
+    json.endObject();
+    json.finish();
+}
+
+std::string scoreToJSON(const Score& score, JSONLayout layout, unsigned workers) {
+    std::string text;
+    {
+        OutputSink out(text);
+        writeJSON(score, out, layout, workers);
+    }
+    return text;
+}
+
+// ============================================
+// NDJSON Events
+// ============================================
+// One hand's position while a played step is walked
+struct HandCursor {
+    const Hand& hand;
+    const char* name;
+    int octave;
+    uint64_t time;   // ticks from the start of the score
+    size_t chord;
+    size_t chunk;
+
+    HandCursor(const Hand& hand, const char* name, int octave, uint64_t time)
+        : hand(hand), name(name), octave(octave), time(time), chord(0), chunk(0) {}
+
+    bool done() const { return chord >= hand.chordCount(); }
+
+    void advance() {
+        time += hand.ticks[chord];
+        chord++;
+        while (chunk < hand.chunkCount() && hand.chunk_starts[chunk + 1] <= chord) chunk++;
+    }
+};
+
+static double timeInBeats(uint64_t ticks) {
+    return static_cast<double>(ticks) / TICKS_PER_BEAT;
+}
+
+// A record for every sounding note of the cursor's current chord
+static void writeChordEvents(JSONWriter& json, const MapBlock& map_block, const HandCursor& cursor,
+                             const Segment* segment) {
+    const Hand& hand = cursor.hand;
+    size_t c = cursor.chord;
+    for (size_t n = hand.chord_starts[c]; n < hand.chord_starts[c + 1]; n++) {
+        Note note = hand.note(c, n);
+        if (note.is_rest || !map_block.hasPitch(note.degree)) continue;
+
+        json.startObject();
+        json.addNumber("time", timeInBeats(cursor.time));
+        json.addNumber("duration", ticksToBeats(note.ticks));
+        json.addString("hand", cursor.name);
+        if (segment) json.addNumber("segment", segment->id);
+        json.addNumber("chunk", static_cast<int>(cursor.chunk));
+        json.addNumber("chord", static_cast<int>(c));
+        json.addNumber("degree", note.degree);
+        json.addString("pitch", map_block.pitch(note.degree));
+        json.addNumber("midi", midiNote(*map_block.table, note.degree, accidentalSemitones(note.accidental),
+                                        cursor.octave + note.octave_shift));
+        if (note.accidental != Accidental::NONE) json.addString("accidental", accidentalText(note.accidental));
+        if (note.octave_shift != 0) json.addNumber("octaveShift", note.octave_shift);
+        if (note.is_dotted) json.addBool("isDotted", true);
+        if (note.articulation != Articulation::NONE) json.addString("articulation", articulationText(note.articulation));
+        if (note.dynamic != Dynamic::NONE) json.addString("dynamic", dynamicText(note.dynamic));
+        json.endObject();
+        json.finish();
+    }
+}
+
+void writeNDJSON(const Score& score, OutputSink& out) {
+    const MapBlock& map_block = score.map_block;
+    JSONWriter json(out, false);
+    uint64_t left_time = 0;
+    uint64_t right_time = 0;
+
+    forEachPlayed(score.playback, [&](const PlayStep& step) {
+        const Segment* segment = nullptr;
+        const Hand* left;
+        const Hand* right;
+        if (step.op == PlayOp::SEGMENT) {
+            segment = &score.segments[step.index];
+            left = &segment->left;
+            right = &segment->right;
+        } else {
+            const InlineEvent& event = score.playback.inline_events[step.index];
+            left = &event.left;
+            right = &event.right;
+        }
+
+        // Merge the two hands by start time, left first on a tie
+        HandCursor l(*left, "left", LEFT_HAND_OCTAVE, left_time);
+        HandCursor r(*right, "right", RIGHT_HAND_OCTAVE, right_time);
+        while (!l.done() || !r.done()) {
+            HandCursor& next = r.done() || (!l.done() && l.time <= r.time) ? l : r;
+            writeChordEvents(json, map_block, next, segment);
+            next.advance();
+        }
+        left_time = l.time;
+        right_time = r.time;
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef AMS_JSON_HPP
+#define AMS_JSON_HPP
+
+// AMS JSON - JSON emitter over the shared IR
+//
+// writeJSON streams the document into a sink as it walks the score, so no
+// part of it is ever built up as a string first. scoreToJSON collects the
+// same bytes into a string.
+//
+// The minified layout has no whitespace and leaves out members that hold
+// their default: isRest and isDotted when false, accidental, articulation
+// and dynamic when "", octaveShift when 0. A note's duration and isDotted
+// are always its chord's, so notes leave them out too.
+//
+// writeNDJSON writes one record per sounding note, one per line, in the
+// order Main() plays them (repeats unrolled). Within a played step the two
+// hands are merged by start time. Every record is flat:
+//
+//     {"time":4,"duration":1,"hand":"right","segment":1,"chunk":1,"chord":4,"degree":5,"pitch":"A","midi":69}
+//
+// time and duration are notated time in beats: rests advance time, both
+// hands share one clock per played step and staccato is not shortened.
+// This is not the MIDI timing, where rests take no time and each hand's
+// track keeps its own clock. midi is the note number the MIDI emitter
+// plays. segment is left out for the LEFT:/RIGHT: lines of Main(), and
+// the note's own markings are added as in the minified layout.
+
+#include <string>
+
+#include "AMS_IR.hpp"
+#include "AMS_Output.hpp"
+
+enum class JSONLayout { PRETTY, MINIFIED };
+
+// Segments are rendered on up to `workers` threads (0: one per hardware
+// thread) when the score is large enough; the output is the same.
+void writeJSON(const Score& score, OutputSink& out, JSONLayout layout = JSONLayout::PRETTY, unsigned workers = 1);
+
+std::string scoreToJSON(const Score& score, JSONLayout layout = JSONLayout::PRETTY, unsigned workers = 1);
+
+void writeNDJSON(const Score& score, OutputSink& out);
+
+#endif
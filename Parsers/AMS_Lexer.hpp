@@ -0,0 +1,213 @@
+#ifndef AMS_LEXER_HPP
+#define AMS_LEXER_HPP
+
+// AMS Lexer - shared by the JSON, TOML and MIDI front ends
+//
+// Every source line (comments removed, trimmed) is classified into exactly
+// one token in a single forward pass. Structural headers such as
+// `Segment(id, NAME)`, `Define NAME {`, `Repeat(n) {` and `Tempo(n)` have
+// their fields decoded here, so the parsers never need std::regex.
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <climits>
+
+#include "AMS_Source.hpp"
+
+enum class TokenKind {
+    BLANK,        // empty line
+    TEXT,         // anything else: metadata, note data, Use(...), ...
+    MAP,          // Map {
+    DEFINE,       // Define NAME {
+    SEGMENT,      // Segment(id, NAME), a call in Main() when followed by ';'
+    TEMPO,        // Tempo(n)
+    BEGIN_LEFT,   // Begin.LEFT {
+    BEGIN_RIGHT,  // Begin.RIGHT {
+    SYNC,         // SYNC()
+    POSITION,     // Position(n)
+    REPEAT,       // Repeat(n) {
+    MAIN,         // Main()
+    INLINE_LEFT,  // LEFT: ...
+    INLINE_RIGHT, // RIGHT: ...
+    END,          // END;
+    OPEN_BRACE,   // {
+    CLOSE_BRACE   // }
+};
+
+struct Token {
+    TokenKind kind;
+    bool well_formed;    // false when the keyword matched but the rest did not
+    int number;          // segment id, repeat count or tempo
+    std::string_view name; // segment or macro name, a slice of the source
+    bool terminated;     // Segment(...) immediately followed by ';'
+
+    Token() : kind(TokenKind::BLANK), well_formed(true), number(0), terminated(false) {}
+};
+
+// ============================================
+// Scanning Helpers
+// ============================================
+inline bool lexPrefix(std::string_view line, std::string_view prefix) {
+    return line.substr(0, prefix.size()) == prefix;
+}
+
+inline bool lexSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline void lexSkipSpace(std::string_view line, size_t& pos) {
+    while (pos < line.size() && lexSpace(line[pos])) pos++;
+}
+
+// Reads a run of decimal digits; fails on an empty run or int overflow.
+inline bool lexNumber(std::string_view line, size_t& pos, int& value) {
+    size_t start = pos;
+    long long result = 0;
+    while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9') {
+        result = result * 10 + (line[pos] - '0');
+        if (result > INT_MAX) return false;
+        pos++;
+    }
+    if (pos == start) return false;
+    value = static_cast<int>(result);
+    return true;
+}
+
+// Identifiers are [A-Z_]+, as accepted by the original grammar.
+inline bool lexName(std::string_view line, size_t& pos, std::string_view& name) {
+    size_t start = pos;
+    while (pos < line.size() && ((line[pos] >= 'A' && line[pos] <= 'Z') || line[pos] == '_')) {
+        pos++;
+    }
+    if (pos == start) return false;
+    name = line.substr(start, pos - start);
+    return true;
+}
+
+inline bool lexChar(std::string_view line, size_t& pos, char c) {
+    if (pos < line.size() && line[pos] == c) {
+        pos++;
+        return true;
+    }
+    return false;
+}
+
+// ============================================
+// Header Decoders
+// ============================================
+
+// Segment(<digits>,\s*<NAME>) with an optional trailing ';'
+inline void lexSegment(std::string_view line, Token& tok) {
+    size_t pos = 8;  // past "Segment("
+    tok.well_formed = false;
+    if (!lexNumber(line, pos, tok.number) || !lexChar(line, pos, ',')) return;
+    lexSkipSpace(line, pos);
+    if (!lexName(line, pos, tok.name) || !lexChar(line, pos, ')')) return;
+    tok.well_formed = true;
+    tok.terminated = lexChar(line, pos, ';');
+}
+
+// Define\s+<NAME>\s*{
+inline void lexDefine(std::string_view line, Token& tok) {
+    size_t pos = 6;  // past "Define", the caller has seen the space
+    tok.well_formed = false;
+    lexSkipSpace(line, pos);
+    if (!lexName(line, pos, tok.name)) return;
+    lexSkipSpace(line, pos);
+    tok.well_formed = lexChar(line, pos, '{');
+}
+
+// Repeat(<digits>)\s*{
+inline void lexRepeat(std::string_view line, Token& tok) {
+    size_t pos = 7;  // past "Repeat("
+    tok.well_formed = false;
+    if (!lexNumber(line, pos, tok.number) || !lexChar(line, pos, ')')) return;
+    lexSkipSpace(line, pos);
+    tok.well_formed = lexChar(line, pos, '{');
+}
+
+// Tempo(n): the value is the first run of digits on the line, 0 if none.
+inline void lexTempo(std::string_view line, Token& tok) {
+    size_t pos = line.find_first_of("0123456789");
+    if (pos == std::string_view::npos || !lexNumber(line, pos, tok.number)) {
+        tok.number = 0;
+    }
+}
+
+// ============================================
+// Lexer
+// ============================================
+inline Token lexLine(std::string_view line) {
+    Token tok;
+    if (line.empty()) return tok;
+
+    tok.kind = TokenKind::TEXT;
+    switch (line[0]) {
+        case 'S':
+            if (lexPrefix(line, "Segment(")) {
+                tok.kind = TokenKind::SEGMENT;
+                lexSegment(line, tok);
+            } else if (lexPrefix(line, "SYNC()")) {
+                tok.kind = TokenKind::SYNC;
+            }
+            break;
+        case 'D':
+            if (lexPrefix(line, "Define ")) {
+                tok.kind = TokenKind::DEFINE;
+                lexDefine(line, tok);
+            }
+            break;
+        case 'T':
+            if (lexPrefix(line, "Tempo(")) {
+                tok.kind = TokenKind::TEMPO;
+                lexTempo(line, tok);
+            }
+            break;
+        case 'B':
+            if (lexPrefix(line, "Begin.LEFT {")) tok.kind = TokenKind::BEGIN_LEFT;
+            else if (lexPrefix(line, "Begin.RIGHT {")) tok.kind = TokenKind::BEGIN_RIGHT;
+            break;
+        case 'R':
+            if (lexPrefix(line, "Repeat(")) {
+                tok.kind = TokenKind::REPEAT;
+                lexRepeat(line, tok);
+            } else if (lexPrefix(line, "RIGHT:")) {
+                tok.kind = TokenKind::INLINE_RIGHT;
+            }
+            break;
+        case 'M':
+            if (lexPrefix(line, "Main()")) tok.kind = TokenKind::MAIN;
+            else if (lexPrefix(line, "Map {")) tok.kind = TokenKind::MAP;
+            break;
+        case 'P':
+            if (lexPrefix(line, "Position(")) tok.kind = TokenKind::POSITION;
+            break;
+        case 'L':
+            if (lexPrefix(line, "LEFT:")) tok.kind = TokenKind::INLINE_LEFT;
+            break;
+        case 'E':
+            if (line == "END;") tok.kind = TokenKind::END;
+            break;
+        case '{':
+            if (line.size() == 1) tok.kind = TokenKind::OPEN_BRACE;
+            break;
+        case '}':
+            if (line.size() == 1) tok.kind = TokenKind::CLOSE_BRACE;
+            break;
+        default:
+            break;
+    }
+    return tok;
+}
+
+inline std::vector<Token> lexSource(const SourceFile& source) {
+    std::vector<Token> tokens;
+    tokens.reserve(source.lineCount());
+    for (size_t i = 0; i < source.lineCount(); i++) {
+        tokens.push_back(lexLine(source.line(i)));
+    }
+    return tokens;
+}
+
+#endif
@@ -0,0 +1,322 @@
+// AMS MIDI - Standard MIDI File emitter
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "AMS_MIDI.hpp"
+#include "AMS_Util.hpp"
+
+// ============================================
+// MIDI File Writer
+// ============================================
+class MIDIWriter {
+private:
+    std::vector<uint8_t> data;
+    
+    void writeBytes(const std::vector<uint8_t>& bytes) {
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    }
+    
+    void writeByte(uint8_t byte) {
+        data.push_back(byte);
+    }
+    
+    void writeInt16(uint16_t value) {
+        data.push_back((value >> 8) & 0xFF);
+        data.push_back(value & 0xFF);
+    }
+    
+    void writeInt32(uint32_t value) {
+        data.push_back((value >> 24) & 0xFF);
+        data.push_back((value >> 16) & 0xFF);
+        data.push_back((value >> 8) & 0xFF);
+        data.push_back(value & 0xFF);
+    }
+    
+    void writeVarLen(uint32_t value) {
+        if (value >= 0x10000000) {
+            writeByte(0x80 | ((value >> 28) & 0x7F));
+        }
+        if (value >= 0x200000) {
+            writeByte(0x80 | ((value >> 21) & 0x7F));
+        }
+        if (value >= 0x4000) {
+            writeByte(0x80 | ((value >> 14) & 0x7F));
+        }
+        if (value >= 0x80) {
+            writeByte(0x80 | ((value >> 7) & 0x7F));
+        }
+        writeByte(value & 0x7F);
+    }
+    
+    void writeString(const std::string& str) {
+        for (char c : str) {
+            writeByte(static_cast<uint8_t>(c));
+        }
+    }
+
+public:
+    void writeHeader(uint16_t format, uint16_t num_tracks, uint16_t division) {
+        writeString("MThd");
+        writeInt32(6);
+        writeInt16(format);
+        writeInt16(num_tracks);
+        writeInt16(division);
+    }
+    
+    void startTrack() {
+        writeString("MTrk");
+        writeInt32(0);
+    }
+    
+    size_t getTrackLengthPosition() {
+        return data.size() - 4;
+    }
+    
+    void updateTrackLength(size_t pos, uint32_t length) {
+        data[pos] = (length >> 24) & 0xFF;
+        data[pos + 1] = (length >> 16) & 0xFF;
+        data[pos + 2] = (length >> 8) & 0xFF;
+        data[pos + 3] = length & 0xFF;
+    }
+    
+    void writeDeltaTime(uint32_t delta) {
+        writeVarLen(delta);
+    }
+    
+    void writeMetaEvent(uint8_t type, const std::vector<uint8_t>& data) {
+        writeByte(0xFF);
+        writeByte(type);
+        writeVarLen(data.size());
+        writeBytes(data);
+    }
+    
+    void writeNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) {
+        writeByte(0x90 | channel);
+        writeByte(note);
+        writeByte(velocity);
+    }
+    
+    void writeNoteOff(uint8_t channel, uint8_t note) {
+        writeByte(0x80 | channel);
+        writeByte(note);
+        writeByte(64);
+    }
+    
+    void writeProgramChange(uint8_t channel, uint8_t program) {
+        writeByte(0xC0 | channel);
+        writeByte(program);
+    }
+    
+    void writeTempoChange(uint32_t microseconds_per_quarter) {
+        std::vector<uint8_t> tempo_data = {
+            static_cast<uint8_t>((microseconds_per_quarter >> 16) & 0xFF),
+            static_cast<uint8_t>((microseconds_per_quarter >> 8) & 0xFF),
+            static_cast<uint8_t>(microseconds_per_quarter & 0xFF)
+        };
+        writeMetaEvent(0x51, tempo_data);
+    }
+    
+    void writeTimeSignature(uint8_t numerator, uint8_t denominator) {
+        uint8_t denom_log2 = 0;
+        uint8_t temp = denominator;
+        while (temp > 1) {
+            temp >>= 1;
+            denom_log2++;
+        }
+        
+        std::vector<uint8_t> ts_data = {numerator, denom_log2, 24, 8};
+        writeMetaEvent(0x58, ts_data);
+    }
+    
+    void writeTrackName(const std::string& name) {
+        std::vector<uint8_t> name_data(name.begin(), name.end());
+        writeMetaEvent(0x03, name_data);
+    }
+    
+    void writeEndOfTrack() {
+        writeMetaEvent(0x2F, {});
+    }
+    
+    std::string toString() const {
+        return std::string(data.begin(), data.end());
+    }
+    
+    size_t size() const { return data.size(); }
+};
+
+// ============================================
+// MIDI Note Conversion
+// ============================================
+class MIDINoteConverter {
+public:
+    // A table lookup; the note's own accidental is applied on top of the key
+    int pitchToMIDI(const ScaleTable& table, const Note& note, int octave) {
+        return midiNote(table, note.degree, accidentalSemitones(note.accidental), octave + note.octave_shift);
+    }
+    
+    int velocityFromDynamic(Dynamic dynamic) {
+        switch (dynamic) {
+            case Dynamic::PP: return 40;
+            case Dynamic::P: return 60;
+            case Dynamic::MP: return 75;
+            case Dynamic::MF: return 90;
+            case Dynamic::F: return 105;
+            case Dynamic::FF: return 120;
+            default: return 90;
+        }
+    }
+};
+
+// ============================================
+// MIDI Generator
+// ============================================
+class MIDIGenerator {
+private:
+    const Score& score;
+    MIDINoteConverter converter;
+    // The IR timeline is already at MIDI resolution
+    int ticks_per_quarter = TICKS_PER_BEAT;
+    
+    uint32_t tempoToMicroseconds(int bpm) {
+        return 60000000 / bpm;
+    }
+
+public:
+    MIDIGenerator(const Score& s) : score(s) {}
+    
+    std::string generate() {
+        const auto& metadata = score.metadata;
+        const auto& map_block = score.map_block;
+        MIDIWriter midi;
+        
+        midi.writeHeader(1, 3, ticks_per_quarter);
+        
+        // Track 0: Meta
+        midi.startTrack();
+        size_t track0_len_pos = midi.getTrackLengthPosition();
+        size_t track0_start = midi.size();
+        
+        midi.writeDeltaTime(0);
+        midi.writeTrackName(metadata.title);
+        midi.writeDeltaTime(0);
+        midi.writeTempoChange(tempoToMicroseconds(metadata.tempo));
+        midi.writeDeltaTime(0);
+        
+        auto ts_parts = split(metadata.time_signature, '/');
+        uint8_t numerator = 4, denominator = 4;
+        if (ts_parts.size() == 2) {
+            try {
+                numerator = std::stoi(ts_parts[0]);
+                denominator = std::stoi(ts_parts[1]);
+            } catch(...) {}
+        }
+        midi.writeTimeSignature(numerator, denominator);
+        
+        midi.writeDeltaTime(0);
+        midi.writeEndOfTrack();
+        midi.updateTrackLength(track0_len_pos, midi.size() - track0_start);
+        
+        // Track 1: Left
+        midi.startTrack();
+        size_t track1_len_pos = midi.getTrackLengthPosition();
+        size_t track1_start = midi.size();
+        
+        midi.writeDeltaTime(0);
+        midi.writeTrackName("Left Hand");
+        midi.writeDeltaTime(0);
+        midi.writeProgramChange(0, 0);
+        
+        generateHandTrack(midi, map_block, true, 0, LEFT_HAND_OCTAVE);
+        
+        midi.writeDeltaTime(0);
+        midi.writeEndOfTrack();
+        midi.updateTrackLength(track1_len_pos, midi.size() - track1_start);
+        
+        // Track 2: Right
+        midi.startTrack();
+        size_t track2_len_pos = midi.getTrackLengthPosition();
+        size_t track2_start = midi.size();
+        
+        midi.writeDeltaTime(0);
+        midi.writeTrackName("Right Hand");
+        midi.writeDeltaTime(0);
+        midi.writeProgramChange(1, 0);
+        
+        generateHandTrack(midi, map_block, false, 1, RIGHT_HAND_OCTAVE);
+        
+        midi.writeDeltaTime(0);
+        midi.writeEndOfTrack();
+        midi.updateTrackLength(track2_len_pos, midi.size() - track2_start);
+        
+        return midi.toString();
+    }
+
+private:
+    // Plays Main() in order; repeats are unrolled as the track is written
+    void generateHandTrack(MIDIWriter& midi, const MapBlock& map_block, bool is_left,
+                          uint8_t channel, int default_octave) {
+        forEachPlayed(score.playback, [&](const PlayStep& step) {
+            if (step.op == PlayOp::SEGMENT) {
+                const Segment& segment = score.segments[step.index];
+                generateHand(midi, is_left ? segment.left : segment.right, map_block, channel, default_octave);
+            } else {
+                const InlineEvent& event = score.playback.inline_events[step.index];
+                generateHand(midi, is_left ? event.left : event.right, map_block, channel, default_octave);
+            }
+        });
+    }
+
+    void generateHand(MIDIWriter& midi, const Hand& hand, const MapBlock& map_block,
+                      uint8_t channel, int default_octave) {
+        // Chunk boundaries do not affect playback, so walk the chord
+        // columns straight through
+        for (size_t c = 0; c < hand.chordCount(); c++) {
+            uint32_t first = hand.chord_starts[c];
+            uint32_t last = hand.chord_starts[c + 1];
+            if (first == last) continue;
+            
+            int duration_ticks = hand.ticks[c];
+            
+            if (hand.note(c, first).articulation == Articulation::STACCATO) {
+                duration_ticks = duration_ticks / 2;
+            }
+            
+            bool first_note = true;
+            for (uint32_t n = first; n < last; n++) {
+                Note note = hand.note(c, n);
+                if (note.is_rest || note.degree == 0) continue;
+                
+                int midi_note = converter.pitchToMIDI(*map_block.table, note, default_octave);
+                int velocity = converter.velocityFromDynamic(note.dynamic);
+                
+                if (note.articulation == Articulation::STACCATO) velocity = std::min(127, velocity + 20);
+                if (note.articulation == Articulation::LEGATO) velocity = std::max(40, velocity - 10);
+                if (note.articulation == Articulation::ACCENT) velocity = std::min(127, velocity + 30);
+                
+                midi.writeDeltaTime(first_note ? 0 : 0);
+                midi.writeNoteOn(channel, midi_note, velocity);
+                first_note = false;
+            }
+            
+            first_note = true;
+            for (uint32_t n = first; n < last; n++) {
+                Note note = hand.note(c, n);
+                if (note.is_rest || note.degree == 0) continue;
+                
+                int midi_note = converter.pitchToMIDI(*map_block.table, note, default_octave);
+                
+                midi.writeDeltaTime(first_note ? duration_ticks : 0);
+                midi.writeNoteOff(channel, midi_note);
+                first_note = false;
+            }
+        }
+    }
+};
+
+std::string scoreToMIDI(const Score& score) {
+    MIDIGenerator generator(score);
+    return generator.generate();
+}
@@ -0,0 +1,16 @@
+#ifndef AMS_MIDI_HPP
+#define AMS_MIDI_HPP
+
+// AMS MIDI - Standard MIDI File emitter over the shared IR
+//
+// Produces a Format 1 file with a meta track and one track per hand,
+// returned as raw bytes. Each hand track plays Main() in order, walking
+// Score::playback so repeats are unrolled as they are written.
+
+#include <string>
+
+#include "AMS_IR.hpp"
+
+std::string scoreToMIDI(const Score& score);
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef AMS_NOTES_HPP
+#define AMS_NOTES_HPP
+
+// AMS Notes - note-level grammar shared by the JSON, TOML and MIDI front ends
+//
+// Everything here works on std::string_view slices of the hand body and
+// reports results through views or plain values, so decoding a note, a
+// chord or a whole chunk allocates nothing. Numbers are read with
+// std::from_chars; malformed numbers never throw.
+
+#include <string_view>
+#include <charconv>
+#include <cstddef>
+
+// Ticks per beat (quarter note). The timeline is integer ticks throughout:
+// every supported duration, from a sixteenth to a whole note and the
+// dotted values in between, is a whole number of ticks, so chunk sums and
+// MIDI delta times are exact. 480 = 2^5 * 3 * 5 also leaves room for
+// triplets and thirty-seconds.
+const int TICKS_PER_BEAT = 480;
+
+static_assert(TICKS_PER_BEAT % 4 == 0, "a sixteenth and a dotted eighth must be whole ticks");
+
+// A decoded note. The views point into the text that was parsed.
+struct NoteText {
+    int degree;
+    std::string_view accidental;   // "#", "b" or empty
+    int octave_shift;
+    int ticks;                     // duration, TICKS_PER_BEAT per beat
+    bool is_dotted;
+    std::string_view articulation; // "!", "~", ">", "(h)" or empty
+    std::string_view dynamic;      // "p", "mf", ... or empty
+    bool is_rest;
+
+    NoteText() : degree(0), octave_shift(0), ticks(TICKS_PER_BEAT), is_dotted(false), is_rest(false) {}
+};
+
+// ============================================
+// Scanning Helpers
+// ============================================
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline std::string_view trimView(std::string_view str) {
+    size_t start = str.find_first_not_of(" \t\n\r");
+    if (start == std::string_view::npos) return std::string_view();
+    size_t end = str.find_last_not_of(" \t\n\r");
+    return str.substr(start, end - start + 1);
+}
+
+// Reads the leading integer of `str`. Returns the number of characters
+// consumed, or 0 if there is no number or it does not fit in an int.
+inline size_t parseLeadingInt(std::string_view str, int& value) {
+    std::from_chars_result result = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (result.ec != std::errc()) return 0;
+    return static_cast<size_t>(result.ptr - str.data());
+}
+
+// Calls fn(piece) for every non-empty, trimmed piece of `data` between
+// occurrences of `delim`.
+template <typename Fn>
+inline void forEachField(std::string_view data, char delim, Fn&& fn) {
+    while (!data.empty()) {
+        size_t pos = data.find(delim);
+        std::string_view piece = trimView(data.substr(0, pos));
+        if (!piece.empty()) fn(piece);
+        if (pos == std::string_view::npos) break;
+        data.remove_prefix(pos + 1);
+    }
+}
+
+// ============================================
+// Notes
+// ============================================
+inline void parseDurationText(std::string_view str, NoteText& note) {
+    if (str.empty()) {
+        note.ticks = TICKS_PER_BEAT;
+    } else if (str == ".h") {
+        note.ticks = 2 * TICKS_PER_BEAT;
+    } else if (str == ".w") {
+        note.ticks = 4 * TICKS_PER_BEAT;
+    } else if (str == ".e") {
+        note.ticks = TICKS_PER_BEAT / 2;
+    } else if (str == ".s") {
+        note.ticks = TICKS_PER_BEAT / 4;
+    } else if (str == ".h.") {
+        note.ticks = 3 * TICKS_PER_BEAT;
+        note.is_dotted = true;
+    } else if (str == ".") {
+        note.ticks = 3 * TICKS_PER_BEAT / 2;
+        note.is_dotted = true;
+    } else if (str == ".e.") {
+        note.ticks = 3 * TICKS_PER_BEAT / 4;
+        note.is_dotted = true;
+    } else {
+        note.ticks = TICKS_PER_BEAT;
+    }
+}
+
+// Degree numbers that do not fit in an int decode as -1 so that range
+// validation rejects them.
+inline NoteText parseNoteText(std::string_view str) {
+    NoteText note;
+    if (str.empty()) return note;
+
+    if (str[0] == 'R') {
+        note.is_rest = true;
+        parseDurationText(str.substr(1), note);
+        return note;
+    }
+
+    size_t i = 0;
+    while (i < str.size() && isDigit(str[i])) i++;
+    if (i > 0 && parseLeadingInt(str, note.degree) == 0) {
+        note.degree = -1;
+    }
+
+    while (i < str.size()) {
+        char c = str[i];
+
+        if (c == '#' || c == 'b') {
+            note.accidental = str.substr(i, 1);
+            i++;
+        } else if (c == '^') {
+            i++;
+            size_t start = i;
+            if (i < str.size() && str[i] == '-') i++;
+            while (i < str.size() && isDigit(str[i])) i++;
+            parseLeadingInt(str.substr(start, i - start), note.octave_shift);
+        } else if (c == '!' || c == '~' || c == '>') {
+            note.articulation = str.substr(i, 1);
+            i++;
+        } else if (c == '(' && i + 1 < str.size() && str[i + 1] == 'h') {
+            note.articulation = "(h)";
+            i += 3;
+        } else if (c == 'p' || c == 'f' || c == 'm') {
+            size_t start = i;
+            while (i < str.size() && (str[i] == 'p' || str[i] == 'f' || str[i] == 'm')) i++;
+            note.dynamic = str.substr(start, i - start);
+        } else if (c == '.') {
+            parseDurationText(str.substr(i), note);
+            break;
+        } else {
+            i++;
+        }
+    }
+
+    return note;
+}
+
+// ============================================
+// Chords
+// ============================================
+
+// A chord is written as note degrees joined by dots that sit between two
+// digits: "1.3.5" or "1.3.5.h".
+inline bool isChordText(std::string_view str) {
+    for (size_t i = 1; i + 1 < str.size(); i++) {
+        if (str[i] == '.' && isDigit(str[i - 1]) && isDigit(str[i + 1])) return true;
+    }
+    return false;
+}
+
+// Splits chord text at every dot followed by a digit. `head` receives the
+// text before the final split, `last` the final note with its duration
+// suffix ("1.3.5.h" -> "1.3", "5.h").
+inline void splitChordText(std::string_view str, std::string_view& head, std::string_view& last) {
+    size_t split = std::string_view::npos;
+    for (size_t i = 0; i + 1 < str.size(); i++) {
+        if (str[i] == '.' && isDigit(str[i + 1])) split = i;
+    }
+    if (split == std::string_view::npos) {
+        head = std::string_view();
+        last = str;
+    } else {
+        head = str.substr(0, split);
+        last = str.substr(split + 1);
+    }
+}
+
+// Calls fn(part) for every non-empty note part of chord text, in order.
+template <typename Fn>
+inline void forEachChordPart(std::string_view str, Fn&& fn) {
+    size_t start = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '.' && i + 1 < str.size() && isDigit(str[i + 1])) {
+            if (i > start) fn(str.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    if (start < str.size()) fn(str.substr(start));
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef AMS_OUTPUT_HPP
+#define AMS_OUTPUT_HPP
+
+// AMS Output - buffered sink shared by the text emitters
+//
+// Emitters write their output piece by piece (keys, punctuation, numbers)
+// into an OutputSink. A sink over a std::ostream (usually the output file)
+// gathers the pieces in one fixed-size buffer and hands each full buffer
+// to the stream, so writing a score to a file takes the buffer and nothing
+// else, however large the score is. A sink over a std::string appends to
+// it directly.
+//
+// writeOrdered() renders independent parts of a document (segments) into
+// their own strings on the worker pool and writes them out in order, a
+// window at a time. The bytes are exactly those of writing the parts one
+// after the other.
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstddef>
+
+#include "AMS_Parallel.hpp"
+
+class OutputSink {
+private:
+    static const size_t CAPACITY = 64 * 1024;
+
+    std::unique_ptr<char[]> buffer;
+    size_t used;
+    std::ostream* stream;  // one of these two is set
+    std::string* text;     // appended to directly, no buffer
+    bool failed;
+
+    void drain(const char* data, size_t size) {
+        if (failed || size == 0) return;
+        if (!stream->write(data, static_cast<std::streamsize>(size))) failed = true;
+    }
+
+public:
+    explicit OutputSink(std::ostream& out)
+        : buffer(new char[CAPACITY]), used(0), stream(&out), text(nullptr), failed(false) {}
+    explicit OutputSink(std::string& out) : used(0), stream(nullptr), text(&out), failed(false) {}
+
+    ~OutputSink() { flush(); }
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void write(std::string_view data) {
+        if (text) {
+            text->append(data.data(), data.size());
+            return;
+        }
+        if (data.size() > CAPACITY - used) {
+            flush();
+            if (data.size() >= CAPACITY) {
+                drain(data.data(), data.size());
+                return;
+            }
+        }
+        std::memcpy(buffer.get() + used, data.data(), data.size());
+        used += data.size();
+    }
+
+    void put(char c) {
+        if (text) {
+            text->push_back(c);
+            return;
+        }
+        if (used == CAPACITY) flush();
+        buffer[used++] = c;
+    }
+
+    void fill(char c, size_t count) {
+        if (text) {
+            text->append(count, c);
+            return;
+        }
+        while (count > 0) {
+            if (used == CAPACITY) flush();
+            size_t n = count < CAPACITY - used ? count : CAPACITY - used;
+            std::memset(buffer.get() + used, c, n);
+            used += n;
+            count -= n;
+        }
+    }
+
+    void writeInt(long long value) {
+        char digits[24];
+        std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), value);
+        write(std::string_view(digits, static_cast<size_t>(res.ptr - digits)));
+    }
+
+    // Shortest text that reads back as `value`: 4, 0.5, 1.5, 0.25, ...
+    void writeNumber(double value) {
+        char digits[32];
+        std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), value);
+        write(std::string_view(digits, static_cast<size_t>(res.ptr - digits)));
+    }
+
+    // `value` with exactly `precision` decimals, as printf's %.*f
+    void writeFixed(double value, int precision) {
+        char digits[64];
+        std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), value,
+                                                 std::chars_format::fixed, precision);
+        write(std::string_view(digits, static_cast<size_t>(res.ptr - digits)));
+    }
+
+    // Hands the buffer to the destination. Returns false once any write
+    // to a stream has failed.
+    bool flush() {
+        drain(buffer.get(), used);
+        used = 0;
+        if (stream && !failed && !stream->flush()) failed = true;
+        return !failed;
+    }
+
+    bool good() const { return !failed; }
+};
+
+// ============================================
+// Ordered Parallel Writing
+// ============================================
+// Scores with fewer notes than this are written on the calling thread
+const size_t PARALLEL_EMIT_MIN_NOTES = 16384;
+
+// Parts rendered per worker before the window is written out
+const size_t PARALLEL_EMIT_WINDOW = 8;
+
+// Calls write(i, sink) for every i in [0, count) and writes what each call
+// produced to `out` in order of i. With more than one worker the calls run
+// on the pool, each into its own string; calls must only read shared state.
+template <typename Write>
+void writeOrdered(OutputSink& out, size_t count, unsigned workers, Write write) {
+    if (workers == 0) workers = defaultWorkerCount();
+    if (workers <= 1 || count < 2) {
+        for (size_t i = 0; i < count; i++) write(i, out);
+        return;
+    }
+
+    size_t window = static_cast<size_t>(workers) * PARALLEL_EMIT_WINDOW;
+    std::vector<std::string> parts(std::min(window, count));
+    for (size_t begin = 0; begin < count; begin += window) {
+        size_t n = std::min(window, count - begin);
+        parallelFor(n, workers, [&](size_t i) {
+            parts[i].clear();
+            OutputSink sink(parts[i]);
+            write(begin + i, sink);
+        });
+        for (size_t i = 0; i < n; i++) out.write(parts[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+// AMS Parallel - work-stealing loop
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "AMS_Parallel.hpp"
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> items;
+};
+
+static bool takeOwn(WorkQueue& queue, size_t& item) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) return false;
+    item = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+static bool stealOther(std::vector<WorkQueue>& queues, unsigned self, size_t& item) {
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkQueue& victim = queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned defaultWorkerCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void parallelFor(size_t count, unsigned workers, const std::function<void(size_t)>& fn) {
+    if (workers == 0) workers = defaultWorkerCount();
+    if (workers > count) workers = static_cast<unsigned>(count);
+
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    // No items are added once the loop starts, so a worker that finds
+    // every queue empty is done.
+    std::vector<WorkQueue> queues(workers);
+    for (unsigned w = 0; w < workers; w++) {
+        size_t begin = count * w / workers;
+        size_t end = count * (w + 1) / workers;
+        for (size_t i = begin; i < end; i++) queues[w].items.push_back(i);
+    }
+
+    // The first exception stops every worker from taking more items and is
+    // rethrown here once they have all stopped
+    std::exception_ptr failure;
+    std::mutex failure_mutex;
+    std::atomic<bool> failed(false);
+
+    auto run = [&](unsigned self) {
+        size_t item;
+        while (!failed.load(std::memory_order_relaxed) &&
+               (takeOwn(queues[self], item) || stealOther(queues, self, item))) {
+            try {
+                fn(item);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (!failure) failure = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    // Items of a worker that cannot be started are stolen by the others
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers; w++) {
+        try {
+            threads.emplace_back(run, w);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    run(0);
+    for (auto& thread : threads) thread.join();
+
+    if (failure) std::rethrow_exception(failure);
+}
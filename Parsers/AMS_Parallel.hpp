@@ -0,0 +1,22 @@
+#ifndef AMS_PARALLEL_HPP
+#define AMS_PARALLEL_HPP
+
+// AMS Parallel - a small work-stealing loop
+//
+// parallelFor() splits [0, count) into one contiguous run per worker.
+// Each worker takes items from the front of its own queue; once that is
+// empty it steals from the back of the other queues, so one slow item
+// (a huge score, a long segment) does not hold the others up.
+
+#include <cstddef>
+#include <functional>
+
+// Number of workers to use when the caller does not specify one
+unsigned defaultWorkerCount();
+
+// Calls fn(i) for every i in [0, count) on up to `workers` threads and
+// returns once all calls have finished. If fn throws, no further items are
+// started and the first exception is rethrown on the calling thread.
+void parallelFor(size_t count, unsigned workers, const std::function<void(size_t)>& fn);
+
+#endif
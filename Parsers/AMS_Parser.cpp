@@ -0,0 +1,1192 @@
+// AMS Parser - parser implementation shared by the JSON, TOML and MIDI converters
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+
+#include "AMS_Parser.hpp"
+#include "AMS_Util.hpp"
+#include "AMS_Parallel.hpp"
+#include "AMS_Timing.hpp"
+
+// ============================================
+// Construction
+// ============================================
+AMSParser::AMSParser(const std::string& filename, bool map_source)
+    : filename(filename), current_line(0), has_main_block(false), reused_blocks(0), worker_count(0),
+      map_source(map_source), fast_path(false), fast(false) {
+    load();
+}
+
+void AMSParser::load() {
+    tokens.clear();
+    if (!source.open(filename, map_source)) {
+        ParseError err;
+        err.line_number = 0;
+        err.error_type = "FILE";
+        err.error_message = "Cannot open file: " + filename;
+        errors.push_back(err);
+        return;
+    }
+
+    tokens = lexSource(source);
+}
+
+// ============================================
+// Diagnostics
+// ============================================
+void AMSParser::printErrors() const {
+    printErrors(std::cerr);
+}
+
+void AMSParser::printErrors(std::ostream& out) const {
+    out << "\n╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║                    COMPILATION FAILED                          ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝\n\n";
+    
+    for (const auto& err : errors) {
+        out << "┌─ [" << err.error_type << " ERROR] ";
+        out << "at line " << err.line_number << "\n";
+        out << "│\n";
+        
+        std::string_view line_content = errorLine(err.line_number);
+        if (!line_content.empty()) {
+            out << "│  " << err.line_number << " │ " << line_content << "\n";
+            out << "│    │ ";
+            for (size_t i = 0; i < line_content.length(); i++) {
+                out << "^";
+            }
+            out << "\n";
+        }
+        
+        out << "│\n";
+        out << "└─ " << err.error_message << "\n\n";
+    }
+    
+    out << "Total errors: " << errors.size() << "\n";
+}
+
+// Thrown by addError() on the fast path; parse() catches it and starts over
+struct FastPathAnomaly {};
+
+static ParseError makeError(const std::string& type, const std::string& message, int line_num) {
+    ParseError err;
+    err.error_type = type;
+    err.error_message = message;
+    err.line_number = line_num + 1;  // Convert to 1-indexed
+    return err;
+}
+
+void AMSParser::addError(const std::string& type, const std::string& message, int line_num) {
+    if (fast) throw FastPathAnomaly();
+    if (line_num == -1) {
+        line_num = current_line;
+    }
+    
+    errors.push_back(makeError(type, message, line_num));
+}
+
+// Diagnostics keep only the line number; the text is sliced from the
+// source when the report is printed.
+std::string_view AMSParser::errorLine(int line_number) const {
+    if (line_number <= 0 || static_cast<size_t>(line_number) > source.lineCount()) return {};
+
+    std::string_view text = source.rawLine(line_number - 1);
+    size_t start = text.find_first_not_of(" \t\n\r");
+    if (start == std::string_view::npos) return {};
+    size_t end = text.find_last_not_of(" \t\n\r");
+    return text.substr(start, end - start + 1);
+}
+
+// ============================================
+// Block Parsing
+// ============================================
+// The macros a block may Use(): the complete Define blocks above it
+struct MacroScope {
+    const std::vector<Macro>& macros;
+    const SymbolPool& symbols;
+    const SymbolMap& index;
+
+    const Macro* find(Symbol name, size_t before_line) const {
+        int slot = index.get(name);
+        if (slot == -1) return nullptr;
+        const Macro& macro = macros[slot];
+        return static_cast<size_t>(macro.definition_line) < before_line ? &macro : nullptr;
+    }
+
+    const Macro* find(std::string_view name, size_t before_line) const {
+        return find(symbols.find(name), before_line);
+    }
+};
+
+static uint64_t hashResolved(const Macro* macro, uint64_t hash) {
+    uint64_t resolved = macro ? macro->hash : 0;
+    return hashBytes(std::string_view(reinterpret_cast<const char*>(&resolved), sizeof(resolved)), hash);
+}
+
+// Combines what each name resolved to, so reparse() can tell whether a
+// block's Use() calls would still splice in the same notes. Symbols are
+// never reused for another name, so hashing the handle is enough.
+static uint64_t macroDependencyHash(const ParsedBlock& block, const MacroScope& scope, size_t first_line) {
+    uint64_t hash = 0;
+    for (Symbol name : block.used_macros) {
+        hash = hashBytes(std::string_view(reinterpret_cast<const char*>(&name), sizeof(name)), hash);
+        hash = hashResolved(scope.find(name, first_line), hash);
+    }
+    for (const auto& name : block.missing_macros) {
+        hash = hashBytes(name, hash);
+        hash = hashResolved(scope.find(name, first_line), hash);
+    }
+    return hash;
+}
+
+// Parses the body of one Define or Segment block found by the pre-scan.
+// It only reads the shared source and tokens and keeps its own cursor and
+// diagnostics, so separate blocks can be parsed on separate threads.
+class BlockParser {
+private:
+    const SourceFile& source;
+    const std::vector<Token>& tokens;
+    size_t first_line;
+    size_t current_line;
+    size_t carry_line;  // where the chord continued onto later lines began
+    std::vector<ParseError>& errors;
+    const MacroScope& scope;
+    bool fast;  // see AMSParser::setFastPath
+    std::vector<Symbol> used_macros;
+    std::vector<std::string> missing_macros;
+
+public:
+    BlockParser(const SourceFile& source, const std::vector<Token>& tokens, size_t first_line,
+                std::vector<ParseError>& errors, const MacroScope& scope, bool fast)
+        : source(source), tokens(tokens), first_line(first_line), current_line(first_line),
+          carry_line(first_line), errors(errors), scope(scope), fast(fast) {}
+
+    // Both start on the header line. They return true when the block's
+    // terminator ('}' or END;) was found.
+    bool parseMacro(const std::string& macro_name, Hand& hand);
+    bool parseSegment(Segment& seg);
+
+    // Every name passed to Use() so far, once each, in order of first use.
+    // Names that were never interned cannot have a Symbol; they are kept
+    // as text.
+    std::vector<Symbol>& usedMacros() { return used_macros; }
+    std::vector<std::string>& missingMacros() { return missing_macros; }
+
+    // The notes of one inline LEFT: or RIGHT: line of Main(), appended to
+    // `hand` as a chunk of their own
+    void parseInlineHand(std::string_view notes, Hand& hand);
+
+private:
+    void addError(const std::string& type, const std::string& message, int line_num = -1);
+    Hand parseHand();
+    bool parseHandBody(Hand& hand);
+    void parseHandLine(std::string_view line, std::string& carry, Hand& hand);
+    void parseCarry(std::string& carry, Hand& hand);
+    void parseField(std::string_view field, Hand& hand);
+    void parseChord(std::string_view str, Hand& hand);
+    void parseUse(std::string_view field, Hand& hand);
+    void addChordNote(Hand& hand, int degree, std::string_view text);
+};
+
+void BlockParser::addError(const std::string& type, const std::string& message, int line_num) {
+    if (fast) throw FastPathAnomaly();
+    if (line_num == -1) {
+        line_num = current_line;
+    }
+    
+    errors.push_back(makeError(type, message, line_num));
+}
+
+// A macro body is read exactly like a hand block
+bool BlockParser::parseMacro(const std::string& macro_name, Hand& hand) {
+    int definition_line = current_line;
+    if (parseHandBody(hand)) {
+        return true;
+    }
+    
+    addError("SYNTAX", "Unclosed Define block for macro '" + macro_name + "' - missing '}'", definition_line);
+    return false;
+}
+
+bool BlockParser::parseSegment(Segment& seg) {
+    current_line++;
+    bool has_left = false;
+    bool has_right = false;
+
+    while (current_line < source.lineCount()) {
+        const Token& line_tok = tokens[current_line];
+
+        if (line_tok.kind == TokenKind::BLANK) {
+            current_line++;
+            continue;
+        }
+
+        if (line_tok.kind == TokenKind::END) {
+            // Warn if missing hands
+            if (!has_left && !has_right) {
+                addError("LOGIC", "Segment '" + seg.name + "' has no hand blocks defined", seg.definition_line);
+            }
+            return true;
+        }
+
+        if (line_tok.kind == TokenKind::TEMPO) {
+            seg.tempo = line_tok.number;
+            if (seg.tempo <= 0 || seg.tempo > 300) {
+                addError("LOGIC", "Invalid tempo in segment: " + std::to_string(seg.tempo));
+            }
+        } else if (line_tok.kind == TokenKind::BEGIN_LEFT) {
+            if (has_left) {
+                addError("REDEFINITION", "Multiple Begin.LEFT blocks in segment '" + seg.name + "'");
+            }
+            has_left = true;
+            seg.left = parseHand();
+        } else if (line_tok.kind == TokenKind::BEGIN_RIGHT) {
+            if (has_right) {
+                addError("REDEFINITION", "Multiple Begin.RIGHT blocks in segment '" + seg.name + "'");
+            }
+            has_right = true;
+            seg.right = parseHand();
+        } else {
+            addError("SYNTAX", "Unexpected content in segment: " + std::string(source.line(current_line)));
+        }
+
+        current_line++;
+    }
+    
+    addError("SYNTAX", "Segment '" + seg.name + "' missing END; terminator", seg.definition_line);
+    return false;
+}
+
+void BlockParser::parseInlineHand(std::string_view notes, Hand& hand) {
+    std::string carry;
+    parseHandLine(notes, carry, hand);
+    parseField(carry, hand);
+    hand.endChunk();
+}
+
+// The block is read line by line: the hand's lines joined with spaces form
+// one stream of chords separated by ',' and chunks separated by '|'. Each
+// chord is parsed as soon as its separator is seen, so only a chord that
+// continues onto the next line is ever copied.
+Hand BlockParser::parseHand() {
+    Hand hand;
+    int hand_start_line = current_line;
+    if (!parseHandBody(hand)) {
+        addError("SYNTAX", "Unclosed hand block - missing '}'", hand_start_line);
+    }
+    return hand;
+}
+
+// Reads from the line after current_line up to the closing '}' and leaves
+// current_line on it. An unclosed block contributes no notes and keeps no
+// diagnostics; the caller reports the missing '}'.
+bool BlockParser::parseHandBody(Hand& hand) {
+    size_t first_error = errors.size();
+    current_line++;
+
+    std::string carry;  // start of a chord that continues on the next line
+    
+    while (current_line < source.lineCount()) {
+        TokenKind kind = tokens[current_line].kind;
+
+        if (kind == TokenKind::BLANK) {
+            current_line++;
+            continue;
+        }
+
+        if (kind == TokenKind::CLOSE_BRACE) {
+            parseCarry(carry, hand);
+            hand.endChunk();
+            return true;
+        }
+
+        if (kind == TokenKind::SYNC || kind == TokenKind::POSITION) {
+            current_line++;
+            continue;
+        }
+
+        parseHandLine(source.line(current_line), carry, hand);
+        current_line++;
+    }
+    
+    errors.resize(first_error);
+    hand = Hand();
+    return false;
+}
+
+void BlockParser::parseHandLine(std::string_view line, std::string& carry, Hand& hand) {
+    size_t start = 0;
+    size_t pos;
+    while ((pos = line.find_first_of(",|", start)) != std::string_view::npos) {
+        std::string_view piece = line.substr(start, pos - start);
+        if (carry.empty()) {
+            parseField(piece, hand);
+        } else {
+            carry += piece;
+            parseCarry(carry, hand);
+        }
+        if (line[pos] == '|') hand.endChunk();
+        start = pos + 1;
+    }
+
+    // A statement ending in ';', such as Use(NAME);, ends with its line
+    std::string_view tail = line.substr(start);
+    std::string_view trimmed = trimView(tail);
+    if (!trimmed.empty() && trimmed.back() == ';') {
+        if (carry.empty()) {
+            parseField(trimmed, hand);
+        } else {
+            carry += tail;
+            parseCarry(carry, hand);
+        }
+    } else if (!carry.empty() || !trimmed.empty()) {
+        if (carry.empty()) carry_line = current_line;
+        carry += tail;
+        carry += ' ';
+    }
+}
+
+// A chord that continued across lines is reported on the line it started
+// on, not the one that completed it
+void BlockParser::parseCarry(std::string& carry, Hand& hand) {
+    size_t line = current_line;
+    current_line = carry_line;
+    parseField(carry, hand);
+    current_line = line;
+    carry.clear();
+}
+
+void BlockParser::parseField(std::string_view field, Hand& hand) {
+    field = trimView(field);
+    if (field.empty()) return;
+    if (startsWith(field, "Use(")) {
+        parseUse(field, hand);
+    } else {
+        parseChord(field, hand);
+    }
+}
+
+// Use(NAME) with an optional ';' splices in the macro's parsed notes
+void BlockParser::parseUse(std::string_view field, Hand& hand) {
+    size_t pos = 4;  // past "Use("
+    std::string_view name;
+    if (!lexName(field, pos, name) || !lexChar(field, pos, ')')) {
+        addError("SYNTAX", "Invalid Use syntax - expected: Use(NAME);");
+        return;
+    }
+    lexChar(field, pos, ';');
+    if (pos != field.size()) {
+        addError("SYNTAX", "Invalid Use syntax - expected: Use(NAME);");
+        return;
+    }
+
+    // Recorded for reparse(), which the fast path does not serve
+    Symbol symbol = scope.symbols.find(name);
+    if (!fast) {
+        if (symbol == NO_SYMBOL) {
+            if (std::find(missing_macros.begin(), missing_macros.end(), name) == missing_macros.end()) {
+                missing_macros.emplace_back(name);
+            }
+        } else if (std::find(used_macros.begin(), used_macros.end(), symbol) == used_macros.end()) {
+            used_macros.push_back(symbol);
+        }
+    }
+
+    const Macro* macro = scope.find(symbol, first_line);
+    if (!macro) {
+        addError("SEMANTIC", "Undefined macro: " + std::string(name) + " (Macro not defined before use)");
+        return;
+    }
+    hand.append(macro->hand);
+}
+
+void BlockParser::parseChord(std::string_view str, Hand& hand) {
+    uint16_t ticks;
+    bool is_dotted;
+
+    Note fast_note;
+    if (fast && decodeNote(str, fast_note)) {
+        hand.addNote(fast_note);
+        hand.endChord(fast_note.ticks, fast_note.is_dotted);
+        return;
+    }
+
+    // Check if this is a chord (contains dots between digits)
+    // Pattern: digit.digit or digit.digit.duration
+    if (isChordText(str)) {
+        // Parse as chord: 1.3.5 or 1.3.5.h
+        std::string_view head, last;
+        splitChordText(str, head, last);
+
+        // The last part contains the duration suffix
+        NoteText duration_note = parseNoteText(last);
+        ticks = static_cast<uint16_t>(duration_note.ticks);
+        is_dotted = duration_note.is_dotted;
+
+        // Parse all chord notes (just the degree numbers)
+        forEachChordPart(head, [&](std::string_view part) {
+            if (isDigit(part[0])) {
+                int degree;
+                if (parseLeadingInt(part, degree) == 0) degree = -1;
+                addChordNote(hand, degree, part);
+            }
+        });
+
+        // If last part also has a note degree, add it back
+        if (duration_note.degree > 0) {
+            char digits[16];
+            std::to_chars_result res = std::to_chars(digits, digits + sizeof(digits), duration_note.degree);
+            addChordNote(hand, duration_note.degree, std::string_view(digits, res.ptr - digits));
+        }
+    } else {
+        // Single note
+        NoteText text = parseNoteText(str);
+        if (!text.is_rest && text.degree != 0 && (text.degree < 1 || text.degree > 7)) {
+            addError("LOGIC", "Invalid note degree: " + std::string(str) + " (must be 1-7)");
+        }
+        Dynamic dynamic;
+        if (!dynamicFromText(text.dynamic, dynamic)) {
+            addError("LOGIC", "Invalid dynamic: " + std::string(str) + " (must be pp, p, mp, mf, f or ff)");
+        }
+        Note n = packNote(text);
+        hand.addNote(n);
+        ticks = n.ticks;
+        is_dotted = n.is_dotted;
+    }
+
+    hand.endChord(ticks, is_dotted);
+}
+
+void BlockParser::addChordNote(Hand& hand, int degree, std::string_view text) {
+    if (degree < 1 || degree > 7) {
+        addError("LOGIC", "Invalid note degree in chord: " + std::string(text) + " (must be 1-7)");
+    }
+    Note n;
+    n.degree = packSmallInt(degree);
+    hand.addNote(n);
+}
+
+// One top-level Define or Segment header, as found by the pre-scan
+struct BlockTask {
+    bool has_block;           // false: a rejected header, see header_error
+    bool reused;              // taken over from the previous parse
+    ParseError header_error;
+    ParsedBlock block;
+    Segment segment;
+    Macro macro;
+};
+
+// ============================================
+// Parsing
+// ============================================
+bool AMSParser::parse() {
+    // A file that could not be loaded goes straight to the report
+    if (fast_path && errors.empty()) {
+        fast = true;
+        try {
+            return parseSource();
+        } catch (const FastPathAnomaly&) {
+            reset();
+        }
+    }
+
+    fast = false;
+    return parseSource();
+}
+
+bool AMSParser::parseSource() {
+    // Parse metadata
+    parseMetadata();
+
+    // Parse Map block (required)
+    if (!parseMap()) {
+        addError("SEMANTIC", "Missing required Map block - every AMS file must define a Map");
+        return false;
+    }
+
+    // Validate Map block
+    if (!validateMap()) {
+        return false;
+    }
+
+    // Generate note mapping
+    generateNoteMapping();
+
+    // Parse macros and segments: find every block first, parse the macros
+    // in order and the segments concurrently, then merge the results back
+    // in source order
+    std::vector<BlockTask> tasks;
+    scanBlocks(tasks);
+    parseMacros(tasks);
+    reuseBlocks(tasks);
+    parseBlocks(tasks);
+    mergeBlocks(tasks);
+
+    if (has_main_block) {
+        parseMain();
+    }
+
+    // Validate
+    if (!has_main_block) {
+        addError("SEMANTIC", "Missing required Main() block - every AMS file must define playback order");
+        return false;
+    }
+
+    // If we have segments, validate them
+    if (!score.segments.empty()) {
+        validateSegments();
+    }
+
+    return errors.empty();
+}
+
+void AMSParser::parseMetadata() {
+    while (current_line < source.lineCount()) {
+        if (tokens[current_line].kind == TokenKind::BLANK) {
+            current_line++;
+            continue;
+        }
+        
+        std::string_view line = source.line(current_line);
+
+        if (startsWith(line, "Title:")) {
+            score.metadata.title = extractValue(line);
+        } else if (startsWith(line, "Composer:")) {
+            score.metadata.composer = extractValue(line);
+        } else if (startsWith(line, "Key:")) {
+            score.metadata.key = extractValue(line);
+        } else if (startsWith(line, "Tempo:")) {
+            std::string tempo_str = extractValue(line);
+            try {
+                score.metadata.tempo = std::stoi(tempo_str);
+                if (score.metadata.tempo <= 0 || score.metadata.tempo > 300) {
+                    addError("LOGIC", "Tempo must be between 1 and 300 BPM, got: " + tempo_str);
+                }
+            } catch (...) {
+                addError("SYNTAX", "Invalid tempo value: " + tempo_str);
+            }
+        } else if (startsWith(line, "TimeSignature:")) {
+            score.metadata.time_signature = extractValue(line);
+        } else if (startsWith(line, "Difficulty:")) {
+            std::string diff_str = extractValue(line);
+            try {
+                score.metadata.difficulty = std::stoi(diff_str);
+                if (score.metadata.difficulty < 0 || score.metadata.difficulty > 10) {
+                    addError("LOGIC", "Difficulty must be between 0 and 10, got: " + diff_str);
+                }
+            } catch (...) {
+                addError("SYNTAX", "Invalid difficulty value: " + diff_str);
+            }
+        } else if (tokens[current_line].kind == TokenKind::MAP) {
+            break;
+        }
+
+        current_line++;
+    }
+}
+
+bool AMSParser::parseMap() {
+    if (current_line >= source.lineCount()) return false;
+
+    if (tokens[current_line].kind != TokenKind::MAP) return false;
+
+    score.map_block.defined = true;
+    score.map_block.line_number = current_line;
+    current_line++;
+
+    while (current_line < source.lineCount()) {
+        if (tokens[current_line].kind == TokenKind::BLANK) {
+            current_line++;
+            continue;
+        }
+        
+        if (tokens[current_line].kind == TokenKind::CLOSE_BRACE) {
+            current_line++;
+            return true;
+        }
+
+        std::string_view line = source.line(current_line);
+
+        if (startsWith(line, "Key:")) {
+            score.map_block.key = extractValue(line);
+        } else if (startsWith(line, "Scale:")) {
+            score.map_block.scale = extractValue(line);
+        } else {
+            addError("SYNTAX", "Unexpected content in Map block: " + std::string(line));
+        }
+
+        current_line++;
+    }
+
+    addError("SYNTAX", "Unclosed Map block - missing '}'", score.map_block.line_number);
+    return false;
+}
+
+bool AMSParser::validateMap() {
+    if (score.map_block.key.empty()) {
+        addError("SEMANTIC", "Map block must specify a Key", score.map_block.line_number);
+        return false;
+    }
+    
+    if (score.map_block.scale.empty()) {
+        addError("SEMANTIC", "Map block must specify a Scale", score.map_block.line_number);
+        return false;
+    }
+    
+    if (tonicIndex(score.map_block.key) == -1) {
+        addError("LOGIC", "Invalid key '" + score.map_block.key + "'. Valid keys: C, C#, Db, D, D#, Eb, E, F, F#, Gb, G, G#, Ab, A, A#, Bb, B", score.map_block.line_number);
+        return false;
+    }
+    
+    if (scaleIndex(score.map_block.scale) == -1) {
+        addError("LOGIC", "Invalid scale '" + score.map_block.scale + "'. Valid scales: Major, Minor, HarmonicMinor", score.map_block.line_number);
+        return false;
+    }
+    
+    return true;
+}
+
+// The key and scale were validated, so the table always exists
+void AMSParser::generateNoteMapping() {
+    score.map_block.table = &scaleTable(tonicIndex(score.map_block.key), scaleIndex(score.map_block.scale));
+}
+
+void AMSParser::parseMain() {
+    int main_line = current_line;
+    std::string_view line = source.line(current_line);
+    
+    bool found_open = false;
+    bool found_close = false;
+    
+    // Check if opening brace is on same line as Main()
+    if (line.find('{') != std::string_view::npos) {
+        found_open = true;
+        current_line++;
+    } else {
+        current_line++;
+        
+        // Look for opening brace on next lines
+        while (current_line < source.lineCount()) {
+            if (tokens[current_line].kind == TokenKind::BLANK) {
+                current_line++;
+                continue;
+            }
+            
+            if (tokens[current_line].kind == TokenKind::OPEN_BRACE) {
+                found_open = true;
+                current_line++;
+                break;
+            }
+            
+            addError("SYNTAX", "Expected '{' after Main()");
+            return;
+        }
+    }
+    
+    if (!found_open) {
+        addError("SYNTAX", "Main() block missing opening '{'", main_line);
+        return;
+    }
+    
+    // Compile Main block content into score.playback
+    IdTable segment_index;  // id -> score.segments
+    segment_index.reserve(score.segments.size());
+    for (size_t i = 0; i < score.segments.size(); i++) {
+        segment_index.set(score.segments[i].id, static_cast<int>(i));
+    }
+
+    std::vector<PlayStep>& steps = score.playback.steps;
+    std::vector<InlineEvent>& inline_events = score.playback.inline_events;
+    std::vector<size_t> open_loops;  // steps index of every unclosed Repeat
+    bool in_inline = false;          // the last step is an inline event still being added to
+
+    // A Repeat body is kept only if it plays something; an empty body or a
+    // count of 0 leaves no steps behind
+    auto closeLoop = [&]() {
+        size_t loop = open_loops.back();
+        open_loops.pop_back();
+        if (steps[loop].count == 0 || steps.size() == loop + 1) {
+            steps.resize(loop);
+        } else {
+            steps[loop].end = static_cast<uint32_t>(steps.size());
+        }
+        in_inline = false;
+    };
+
+    while (current_line < source.lineCount()) {
+        if (tokens[current_line].kind == TokenKind::BLANK) {
+            current_line++;
+            continue;
+        }
+        
+        const Token& tok = tokens[current_line];
+        
+        if (tok.kind == TokenKind::CLOSE_BRACE) {
+            if (!open_loops.empty()) {
+                closeLoop();
+                current_line++;
+                continue;
+            }
+            found_close = true;
+            current_line++;
+            break;
+        }
+        
+        // Check for Segment calls
+        if (tok.kind == TokenKind::SEGMENT) {
+            if (tok.well_formed && tok.terminated) {
+                int seg_id = tok.number;
+                
+                // Check if segment exists
+                if (!segment_definitions.has(seg_id)) {
+                    addError("SEMANTIC", "Undefined segment ID: " + std::to_string(seg_id) + 
+                            " (Segment not defined before Main block)");
+                } else {
+                    int index = segment_index.find(seg_id);
+                    if (index != -1) {
+                        steps.push_back({PlayOp::SEGMENT, static_cast<uint32_t>(index), 0, 0});
+                    }
+                }
+            } else {
+                addError("SYNTAX", "Invalid Segment call syntax - expected: Segment(id, NAME);");
+            }
+            in_inline = false;
+        }
+        // Check for Repeat blocks
+        else if (tok.kind == TokenKind::REPEAT) {
+            if (tok.well_formed) {
+                int repeat_count = tok.number;
+                if (repeat_count <= 0) {
+                    addError("LOGIC", "Repeat count must be positive, got: " + std::to_string(repeat_count));
+                }
+                open_loops.push_back(steps.size());
+                steps.push_back({PlayOp::REPEAT, 0, static_cast<uint32_t>(std::max(repeat_count, 0)), 0});
+            } else {
+                addError("SYNTAX", "Invalid Repeat syntax - expected: Repeat(count) {");
+            }
+            in_inline = false;
+        }
+        // Inline hand commands: consecutive LEFT:/RIGHT: lines form one event
+        else if (tok.kind == TokenKind::INLINE_LEFT || tok.kind == TokenKind::INLINE_RIGHT) {
+            if (!in_inline) {
+                steps.push_back({PlayOp::INLINE, static_cast<uint32_t>(inline_events.size()), 0, 0});
+                inline_events.emplace_back();
+                in_inline = true;
+            }
+            
+            std::string_view notes = source.line(current_line).substr(tok.kind == TokenKind::INLINE_LEFT ? 5 : 6);
+            notes = trimView(notes);
+            if (!notes.empty() && notes.back() == ';') notes.remove_suffix(1);
+            
+            InlineEvent& event = inline_events.back();
+            MacroScope scope{score.macros, symbols, macros};
+            BlockParser parser(source, tokens, current_line, errors, scope, fast);
+            parser.parseInlineHand(notes, tok.kind == TokenKind::INLINE_LEFT ? event.left : event.right);
+        }
+        else if (tok.kind != TokenKind::OPEN_BRACE) {
+            addError("SYNTAX", "Unexpected content in Main block: " + std::string(source.line(current_line)));
+        }
+        
+        current_line++;
+    }
+    
+    if (!found_close) {
+        addError("SYNTAX", "Main() block missing closing '}'", main_line);
+    }
+
+    while (!open_loops.empty()) {
+        closeLoop();
+    }
+}
+
+// ============================================
+// Block Pre-scan
+// ============================================
+// Blocks below this many lines in total are parsed on the calling thread;
+// starting workers would cost more than it saves.
+static const size_t PARALLEL_MIN_LINES = 2048;
+
+// One past the last line of the segment whose header is at `first`. This
+// follows BlockParser::parseSegment exactly: a hand runs to its '}' and
+// the segment to END;, whatever lies in between.
+static size_t scanSegmentEnd(const std::vector<Token>& tokens, size_t first) {
+    size_t line = first + 1;
+    while (line < tokens.size()) {
+        TokenKind kind = tokens[line].kind;
+        if (kind == TokenKind::END) return line + 1;
+        if (kind == TokenKind::BEGIN_LEFT || kind == TokenKind::BEGIN_RIGHT) {
+            line++;
+            while (line < tokens.size() && tokens[line].kind != TokenKind::CLOSE_BRACE) line++;
+        }
+        line++;
+    }
+    return tokens.size();
+}
+
+// One past the last line of the Define whose header is at `first`
+static size_t scanMacroEnd(const std::vector<Token>& tokens, size_t first) {
+    size_t line = first + 1;
+    while (line < tokens.size()) {
+        if (tokens[line].kind == TokenKind::CLOSE_BRACE) return line + 1;
+        line++;
+    }
+    return tokens.size();
+}
+
+// Walks the top level up to Main() using tokens only. Headers are checked
+// here, in order, so the duplicate id, name and macro checks see exactly
+// the blocks that came before them.
+void AMSParser::scanBlocks(std::vector<BlockTask>& tasks) {
+    size_t headers = 0;
+    for (size_t i = current_line; i < tokens.size(); i++) {
+        if (tokens[i].kind == TokenKind::DEFINE || tokens[i].kind == TokenKind::SEGMENT) headers++;
+    }
+    tasks.reserve(headers);
+
+    while (current_line < source.lineCount()) {
+        const Token& tok = tokens[current_line];
+
+        if (tok.kind == TokenKind::MAIN) {
+            has_main_block = true;
+            break;
+        }
+        if (tok.kind != TokenKind::DEFINE && tok.kind != TokenKind::SEGMENT) {
+            current_line++;
+            continue;
+        }
+
+        bool is_segment = tok.kind == TokenKind::SEGMENT;
+
+        tasks.emplace_back();
+        BlockTask& task = tasks.back();
+        task.has_block = false;
+        task.reused = false;
+
+        auto reject = [&](const std::string& type, const std::string& message) {
+            if (fast) throw FastPathAnomaly();
+            task.header_error = makeError(type, message, current_line);
+            current_line++;
+        };
+
+        if (!tok.well_formed) {
+            if (is_segment) reject("SYNTAX", "Invalid Segment syntax - expected: Segment(id, NAME)");
+            else reject("SYNTAX", "Invalid Define syntax - expected: Define MACRO_NAME {");
+            continue;
+        }
+
+        Symbol name = symbols.intern(tok.name);
+
+        if (is_segment) {
+            // Check for duplicate segment ID
+            if (segment_definitions.has(tok.number)) {
+                reject("REDEFINITION", "Segment with ID " + std::to_string(tok.number) + 
+                       " already defined at line " + std::to_string(segment_definitions.find(tok.number) + 1));
+                continue;
+            }
+            
+            // Check for duplicate segment name
+            if (segment_name_definitions.has(name)) {
+                reject("REDEFINITION", "Segment with name '" + std::string(tok.name) + 
+                       "' already defined at line " + std::to_string(segment_name_definitions.get(name) + 1));
+                continue;
+            }
+            
+            segment_definitions.set(tok.number, current_line);
+            segment_name_definitions.set(name, current_line);
+
+            task.segment.id = tok.number;
+            task.segment.name = std::string(tok.name);
+            task.segment.tempo = score.metadata.tempo;
+            task.segment.definition_line = current_line;
+        } else {
+            // Check for redefinition
+            if (macro_definitions.has(name)) {
+                reject("REDEFINITION", "Macro '" + std::string(tok.name) + "' already defined at line " + 
+                       std::to_string(macro_definitions.get(name) + 1));
+                continue;
+            }
+
+            macro_definitions.set(name, current_line);
+            task.block.macro_name = std::string(tok.name);
+            task.block.macro_symbol = name;
+        }
+
+        size_t end = is_segment ? scanSegmentEnd(tokens, current_line) : scanMacroEnd(tokens, current_line);
+        task.has_block = true;
+        task.block.is_segment = is_segment;
+        task.block.first_line = current_line;
+        task.block.line_count = end - current_line;
+        task.block.default_tempo = score.metadata.tempo;
+        current_line = end;
+    }
+}
+
+// Records what the block's Use() calls resolved to and its hashes, and
+// makes its diagnostics relative to its first line
+static void finishBlock(const SourceFile& source, const MacroScope& scope, BlockParser& parser,
+                        ParsedBlock& block, bool fast) {
+    // The fast path keeps nothing for reparse(), and found no errors
+    if (fast) return;
+
+    block.used_macros = std::move(parser.usedMacros());
+    block.missing_macros = std::move(parser.missingMacros());
+    block.macro_hash = macroDependencyHash(block, scope, block.first_line);
+    block.head_hash = hashBytes(source.span(block.first_line, 1));
+    block.hash = hashBytes(source.span(block.first_line, block.line_count));
+    for (auto& err : block.parse_errors) {
+        err.line_number -= static_cast<int>(block.first_line);
+    }
+}
+
+// Define bodies are parsed one after another in source order, each seeing
+// only the macros above it. They are short; the segments that Use() them
+// are what parseBlocks() spreads over the workers.
+void AMSParser::parseMacros(std::vector<BlockTask>& tasks) {
+    MacroScope scope{score.macros, symbols, macros};
+
+    for (auto& task : tasks) {
+        if (!task.has_block || task.block.is_segment) continue;
+
+        ParsedBlock& block = task.block;
+        if (!reuseBlock(task)) {
+            BlockParser parser(source, tokens, block.first_line, block.parse_errors, scope, fast);
+            block.complete = parser.parseMacro(block.macro_name, task.macro.hand);
+            finishBlock(source, scope, parser, block, fast);
+        }
+
+        if (block.complete) {
+            task.macro.name = block.macro_name;
+            task.macro.definition_line = static_cast<int>(block.first_line);
+            task.macro.hash = hashBytes(std::string_view(reinterpret_cast<const char*>(&block.macro_hash),
+                                                         sizeof(block.macro_hash)), block.hash);
+            block.macro_index = static_cast<int>(score.macros.size());
+            macros.set(block.macro_symbol, static_cast<int>(score.macros.size()));
+            score.macros.push_back(std::move(task.macro));
+        }
+    }
+}
+
+void AMSParser::parseBlocks(std::vector<BlockTask>& tasks) {
+    size_t lines = 0;
+    for (const auto& task : tasks) {
+        if (task.has_block && task.block.is_segment && !task.reused) lines += task.block.line_count;
+    }
+
+    MacroScope scope{score.macros, symbols, macros};
+
+    // An exception from any block (on the fast path, usually a
+    // FastPathAnomaly) is rethrown here by parallelFor
+    parallelFor(tasks.size(), lines >= PARALLEL_MIN_LINES ? worker_count : 1, [&](size_t i) {
+        BlockTask& task = tasks[i];
+        if (!task.has_block || !task.block.is_segment || task.reused) return;
+
+        ParsedBlock& block = task.block;
+        BlockParser parser(source, tokens, block.first_line, block.parse_errors, scope, fast);
+        block.complete = parser.parseSegment(task.segment);
+        finishBlock(source, scope, parser, block, fast);
+    });
+}
+
+// Appends every block's diagnostics and results in source order, so the
+// outcome does not depend on how the blocks were scheduled.
+void AMSParser::mergeBlocks(std::vector<BlockTask>& tasks) {
+    blocks.reserve(tasks.size());
+    score.segments.reserve(tasks.size());
+    segment_blocks.reserve(tasks.size());
+
+    for (auto& task : tasks) {
+        if (!task.has_block) {
+            errors.push_back(task.header_error);
+            continue;
+        }
+
+        ParsedBlock& block = task.block;
+        restoreErrors(block.parse_errors, block.first_line);
+
+        if (block.is_segment && block.complete) {
+            block.segment_index = static_cast<int>(score.segments.size());
+            segment_blocks.push_back(blocks.size());
+            score.segments.push_back(std::move(task.segment));
+        }
+
+        if (task.reused) reused_blocks++;
+        blocks.push_back(std::move(block));
+    }
+}
+
+// ============================================
+// Validation
+// ============================================
+void AMSParser::validateSegments() {
+    for (size_t i = 0; i < score.segments.size(); i++) {
+        if (fast) {
+            validateSegment(score.segments[i]);
+            continue;
+        }
+
+        ParsedBlock& block = blocks[segment_blocks[i]];
+
+        // A reused block brings its validation result along
+        if (block.validated) {
+            restoreErrors(block.validation_errors, block.first_line);
+            continue;
+        }
+
+        size_t first_error = errors.size();
+        validateSegment(score.segments[i]);
+        saveErrors(first_error, block.first_line, block.validation_errors);
+        block.validated = true;
+    }
+}
+
+void AMSParser::validateSegment(const Segment& seg) {
+    // Check if both hands have data
+    bool left_empty = seg.left.empty();
+    bool right_empty = seg.right.empty();
+    
+    if (left_empty && right_empty) {
+        addError("LOGIC", "Segment '" + seg.name + "' has no musical content", seg.definition_line);
+        return;
+    }
+    
+    // Validate chunk alignment between hands
+    if (!left_empty && !right_empty) {
+        validateChunkAlignment(seg);
+    }
+}
+
+void AMSParser::validateChunkAlignment(const Segment& seg) {
+    // Check if chunks have matching durations; ticks are exact, so they
+    // must be equal. Every mismatched chunk is reported.
+    std::vector<uint32_t> left_totals;
+    std::vector<uint32_t> right_totals;
+    std::vector<size_t> mismatches;
+    chunkTotals(seg.left, left_totals);
+    chunkTotals(seg.right, right_totals);
+    mismatchedChunks(left_totals, right_totals, mismatches);
+    
+    for (size_t i : mismatches) {
+        uint32_t left_ticks = i < left_totals.size() ? left_totals[i] : 0;
+        uint32_t right_ticks = i < right_totals.size() ? right_totals[i] : 0;
+        addError("LOGIC", "Duration mismatch in segment '" + seg.name + "' chunk " + 
+                std::to_string(i + 1) + ": LEFT=" + std::to_string(ticksToBeats(left_ticks)) + 
+                " beats, RIGHT=" + std::to_string(ticksToBeats(right_ticks)) + " beats", 
+                seg.definition_line);
+    }
+}
+
+std::string AMSParser::extractValue(std::string_view line) {
+    size_t pos = line.find(':');
+    if (pos != std::string_view::npos) {
+        std::string value = trim(line.substr(pos + 1));
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            return value.substr(1, value.size() - 2);
+        }
+        return value;
+    }
+    return "";
+}
+
+// ============================================
+// Incremental Re-parse
+// ============================================
+bool AMSParser::reparse() {
+    previous_blocks = std::move(blocks);
+    previous_segments = std::move(score.segments);
+    previous_macros = std::move(score.macros);
+    previous_index.clear();
+    // A fast parse hashed nothing to match against
+    for (size_t i = 0; i < previous_blocks.size() && !fast; i++) {
+        previous_index.emplace(previous_blocks[i].head_hash, i);
+    }
+
+    reset();
+    load();
+    bool ok = parseSource();
+
+    previous_blocks.clear();
+    previous_segments.clear();
+    previous_macros.clear();
+    previous_index.clear();
+    return ok;
+}
+
+// Clears everything a parse builds, keeping the loaded source and the
+// interned names
+void AMSParser::reset() {
+    blocks.clear();
+    segment_blocks.clear();
+    score = Score();
+    macros.clear();
+    macro_definitions.clear();
+    segment_definitions.clear();
+    segment_name_definitions.clear();
+    errors.clear();
+    current_line = 0;
+    has_main_block = false;
+    reused_blocks = 0;
+    fast = false;
+}
+
+// Takes over the previous parse of every block whose span is unchanged.
+// The pre-scan has already fixed each span, so equal bytes over an equal
+// span parse to the same result.
+void AMSParser::reuseBlocks(std::vector<BlockTask>& tasks) {
+    for (auto& task : tasks) {
+        if (task.has_block && task.block.is_segment) reuseBlock(task);
+    }
+}
+
+// Macros are reused from parseMacros(), as they come up in order, so the
+// macro table already holds everything a block's Use() calls can see.
+bool AMSParser::reuseBlock(BlockTask& task) {
+    if (previous_index.empty()) return false;
+
+    MacroScope scope{score.macros, symbols, macros};
+    ParsedBlock& block = task.block;
+    auto range = previous_index.equal_range(hashBytes(source.span(block.first_line, 1)));
+
+    for (auto it = range.first; it != range.second; ++it) {
+        ParsedBlock& old = previous_blocks[it->second];
+
+        if (old.is_segment != block.is_segment || old.line_count != block.line_count) continue;
+        if (block.is_segment && old.default_tempo != block.default_tempo) continue;
+        if (hashBytes(source.span(block.first_line, block.line_count)) != old.hash) continue;
+        if (macroDependencyHash(old, scope, block.first_line) != old.macro_hash) continue;
+
+        size_t first_line = block.first_line;
+        Symbol macro_symbol = block.macro_symbol;
+        block = std::move(old);
+        block.first_line = first_line;
+        block.macro_symbol = macro_symbol;
+        if (block.is_segment && block.complete) {
+            task.segment = std::move(previous_segments[block.segment_index]);
+            task.segment.definition_line = static_cast<int>(first_line);
+        } else if (!block.is_segment && block.complete) {
+            task.macro = std::move(previous_macros[block.macro_index]);
+        }
+
+        previous_index.erase(it);
+        task.reused = true;
+        return true;
+    }
+    return false;
+}
+
+// Errors are stored relative to the block's first line
+void AMSParser::saveErrors(size_t first_error, size_t first_line, std::vector<ParseError>& saved) {
+    saved.assign(errors.begin() + first_error, errors.end());
+    for (auto& err : saved) {
+        err.line_number -= static_cast<int>(first_line);
+    }
+}
+
+void AMSParser::restoreErrors(const std::vector<ParseError>& saved, size_t first_line) {
+    for (const auto& err : saved) {
+        errors.push_back(err);
+        errors.back().line_number += static_cast<int>(first_line);
+    }
+}
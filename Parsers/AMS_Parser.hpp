@@ -0,0 +1,188 @@
+#ifndef AMS_PARSER_HPP
+#define AMS_PARSER_HPP
+
+// AMS Parser - the single front end behind every converter
+//
+// Usage:
+//     AMSParser parser(filename);
+//     if (!parser.parse()) parser.printErrors();
+//     else emit(parser.getScore());
+//
+// The parser owns the source mapping and the diagnostics; the resulting
+// Score is read-only from the outside. Parsers share no mutable state, so
+// separate instances can run on separate threads.
+//
+// Incremental use (editors, --watch):
+//     AMSParser parser(filename, false);
+//     parser.parse();
+//     ...file is saved...
+//     parser.reparse();
+//
+// A parser kept across saves reads the file into memory instead of mapping
+// it: the editor may truncate the file while the source is still used for
+// diagnostics, and reading a truncated mapping faults.
+//
+// parse() pre-scans the token stream for the spans of the Define and
+// Segment blocks (checking headers for duplicates in order). Define bodies
+// are parsed first, in source order, each into a hand fragment that
+// Use(NAME) splices in; a block can only Use() macros defined above it.
+// Segments are then independent: they are parsed concurrently and the
+// results and diagnostics merged back in source order, so the outcome
+// never depends on scheduling. Small files stay on the calling thread.
+//
+// Every top-level Define and Segment block is hashed over its source span.
+// reparse() re-reads the file and reuses the parsed result, diagnostics and
+// validation of every block whose text is unchanged (even if it moved) and
+// whose Use() calls resolve to unchanged macros. Only changed blocks are
+// re-parsed. The header (metadata and Map), the
+// cross-block checks (duplicate ids, names and macros) and Main() are
+// always redone because they are cheap.
+//
+// Fast path (setFastPath): most inputs are machine-generated and valid, so
+// parse() can first run without the bookkeeping that only diagnostics and
+// reparse() use. Block spans are not hashed, Use() dependencies are not
+// recorded and common notes are decoded in one pass (see decodeNote). The
+// first error abandons that attempt and the file is parsed again by the
+// full diagnosing parser, so the errors reported are exactly the usual ones.
+//
+// Segment and macro names are interned as they are declared (see
+// AMS_Symbols.hpp); the symbol tables are indexed by handle or by segment
+// id, so redefinition checks and Main() never compare names.
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "AMS_Source.hpp"
+#include "AMS_Lexer.hpp"
+#include "AMS_Notes.hpp"
+#include "AMS_Score.hpp"
+#include "AMS_IR.hpp"
+#include "AMS_Symbols.hpp"
+
+// ============================================
+// Incremental Re-parse
+// ============================================
+// One top-level Define or Segment block of the last parse. Error lines are
+// kept relative to the block's first line so a moved block can be reused.
+struct ParsedBlock {
+    uint64_t head_hash;          // first line only, used for the lookup
+    uint64_t hash;               // the whole span
+    size_t first_line;
+    size_t line_count;
+    bool is_segment;
+    bool complete;               // END; or '}' was found
+    int default_tempo;           // metadata tempo the segment started from
+    int segment_index;           // into Score::segments, -1 if none
+    std::string macro_name;
+    Symbol macro_symbol;
+    int macro_index;             // into Score::macros, -1 if none
+    std::vector<Symbol> used_macros;          // every name passed to Use(), once
+    std::vector<std::string> missing_macros;  // ...and those not interned at the time
+    uint64_t macro_hash;         // what those names resolved to
+    std::vector<ParseError> parse_errors;
+    bool validated;
+    std::vector<ParseError> validation_errors;
+
+    ParsedBlock() : head_hash(0), hash(0), first_line(0), line_count(0), is_segment(false),
+                    complete(false), default_tempo(0), segment_index(-1), macro_symbol(NO_SYMBOL),
+                    macro_index(-1), macro_hash(0),
+                    validated(false) {}
+};
+
+struct BlockTask;
+
+class AMSParser {
+private:
+    std::string filename;
+    SourceFile source;
+    std::vector<Token> tokens;
+    size_t current_line;
+    Score score;
+    SymbolPool symbols;                  // segment and macro names, kept across reparses
+    SymbolMap macros;                    // name -> score.macros
+    SymbolMap macro_definitions;         // name -> line number
+    IdTable segment_definitions;         // id -> line number
+    SymbolMap segment_name_definitions;  // name -> line number
+    std::vector<ParseError> errors;
+    bool has_main_block;
+
+    std::vector<ParsedBlock> blocks;           // this parse, in source order
+    std::vector<size_t> segment_blocks;        // score.segments[i] -> blocks
+    std::vector<ParsedBlock> previous_blocks;  // the last parse, during reparse()
+    std::vector<Segment> previous_segments;
+    std::vector<Macro> previous_macros;
+    std::unordered_multimap<uint64_t, size_t> previous_index;  // head_hash -> previous_blocks
+    size_t reused_blocks;
+    unsigned worker_count;                     // 0: one per hardware thread
+    bool map_source;                           // map the file rather than copy it
+    bool fast_path;                            // try the fast path first
+    bool fast;                                 // the current or last parse took it
+
+public:
+    AMSParser(const std::string& filename, bool map_source = true);
+
+    // Parses the whole file. Returns true when no errors were found.
+    bool parse();
+
+    // Re-reads the file and parses it again, reusing every unchanged block
+    // of the previous parse. Returns true when no errors were found.
+    bool reparse();
+
+    // Blocks taken over unchanged by the last reparse(), and blocks in total
+    size_t reusedBlockCount() const { return reused_blocks; }
+    size_t blockCount() const { return blocks.size(); }
+
+    // Threads used to parse blocks, 0 for one per hardware thread. Batch
+    // compiles that already run one file per thread set this to 1.
+    void setWorkerCount(unsigned workers) { worker_count = workers; }
+
+    // Lets parse() try the fast path first. Off by default; one-shot
+    // compiles turn it on. reparse() always runs the diagnosing parser,
+    // and reuses nothing after a fast parse.
+    void setFastPath(bool enabled) { fast_path = enabled; }
+
+    // True when the last parse() succeeded on the fast path
+    bool usedFastPath() const { return fast; }
+
+    bool hasErrors() const { return !errors.empty(); }
+    const std::vector<ParseError>& getErrors() const { return errors; }
+    void printErrors() const;  // to std::cerr
+    void printErrors(std::ostream& out) const;
+
+    const Score& getScore() const { return score; }
+
+    // The text the score was parsed from
+    const SourceFile& getSource() const { return source; }
+
+private:
+    void load();
+    void reset();
+    bool parseSource();
+    void addError(const std::string& type, const std::string& message, int line_num = -1);
+    std::string_view errorLine(int line_number) const;
+
+    void parseMetadata();
+    bool parseMap();
+    bool validateMap();
+    void generateNoteMapping();
+    void scanBlocks(std::vector<BlockTask>& tasks);
+    void parseMacros(std::vector<BlockTask>& tasks);
+    void parseBlocks(std::vector<BlockTask>& tasks);
+    void mergeBlocks(std::vector<BlockTask>& tasks);
+    void parseMain();
+    void validateSegments();
+    void validateSegment(const Segment& seg);
+    void validateChunkAlignment(const Segment& seg);
+    std::string extractValue(std::string_view line);
+
+    void reuseBlocks(std::vector<BlockTask>& tasks);
+    bool reuseBlock(BlockTask& task);
+    void saveErrors(size_t first_error, size_t first_line, std::vector<ParseError>& saved);
+    void restoreErrors(const std::vector<ParseError>& saved, size_t first_line);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef AMS_PITCH_HPP
+#define AMS_PITCH_HPP
+
+// AMS Pitch - compile-time scale tables for every key the Map accepts
+//
+// A table per tonic spelling and scale gives each of the seven degrees its
+// spelled name ("F#", "Bb", ...) and its semitone above the C that starts
+// the hand's octave. Octaves are scientific, so they begin at C: in D
+// major, degree 7 (C#) sits below degree 1 (D) of the same octave. A MIDI
+// note number is then one table lookup plus the accidental and octave.
+//
+// The tables are built by constexpr code from the scale steps and the
+// natural letter pitches, so no key ever falls back to another one.
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+enum class ScaleKind : uint8_t { MAJOR, MINOR, HARMONIC_MINOR };
+
+const size_t SCALE_KIND_COUNT = 3;
+
+// The octave each hand plays in before any ^ shift
+const int LEFT_HAND_OCTAVE = 3;
+const int RIGHT_HAND_OCTAVE = 4;
+
+struct ScaleTable {
+    int8_t semitones[7];    // above C of the octave; Cb is -1 and B# is 12
+    const char* names[7];
+};
+
+// ============================================
+// Spelling
+// ============================================
+struct TonicSpelling {
+    const char* name;
+    uint8_t letter;      // 0 = C ... 6 = B
+    int8_t accidental;   // -1 flat, 0 natural, 1 sharp
+};
+
+// All 12 tonics, each under its sharp and flat name where it has both
+constexpr TonicSpelling TONIC_SPELLINGS[] = {
+    {"C", 0, 0}, {"C#", 0, 1}, {"Db", 1, -1}, {"D", 1, 0}, {"D#", 1, 1}, {"Eb", 2, -1},
+    {"E", 2, 0}, {"F", 3, 0}, {"F#", 3, 1}, {"Gb", 4, -1}, {"G", 4, 0}, {"G#", 4, 1},
+    {"Ab", 5, -1}, {"A", 5, 0}, {"A#", 5, 1}, {"Bb", 6, -1}, {"B", 6, 0}
+};
+
+const size_t TONIC_COUNT = sizeof(TONIC_SPELLINGS) / sizeof(TONIC_SPELLINGS[0]);
+
+constexpr int8_t LETTER_SEMITONES[7] = {0, 2, 4, 5, 7, 9, 11};
+
+// Indexed by letter, then accidental + 2 (double flat to double sharp)
+constexpr const char* SPELLED_NAMES[7][5] = {
+    {"Cbb", "Cb", "C", "C#", "C##"}, {"Dbb", "Db", "D", "D#", "D##"}, {"Ebb", "Eb", "E", "E#", "E##"},
+    {"Fbb", "Fb", "F", "F#", "F##"}, {"Gbb", "Gb", "G", "G#", "G##"}, {"Abb", "Ab", "A", "A#", "A##"},
+    {"Bbb", "Bb", "B", "B#", "B##"}
+};
+
+// Semitones of each degree above the tonic
+constexpr int8_t SCALE_STEPS[SCALE_KIND_COUNT][7] = {
+    {0, 2, 4, 5, 7, 9, 11},  // Major
+    {0, 2, 3, 5, 7, 8, 10},  // Minor (natural)
+    {0, 2, 3, 5, 7, 8, 11}   // HarmonicMinor
+};
+
+// Degree d takes the d-th letter above the tonic's; its accidental is
+// whatever makes up the difference to the scale step.
+constexpr ScaleTable buildScaleTable(const TonicSpelling& tonic, size_t scale) {
+    ScaleTable table{};
+    int tonic_semitone = LETTER_SEMITONES[tonic.letter] + tonic.accidental;
+    for (int d = 0; d < 7; d++) {
+        int letter = (tonic.letter + d) % 7;
+        int wrap = (tonic.letter + d) / 7 * 12;
+        int accidental = tonic_semitone + SCALE_STEPS[scale][d] - (LETTER_SEMITONES[letter] + wrap);
+        table.semitones[d] = static_cast<int8_t>(LETTER_SEMITONES[letter] + accidental);
+        table.names[d] = SPELLED_NAMES[letter][accidental + 2];
+    }
+    return table;
+}
+
+constexpr std::array<ScaleTable, TONIC_COUNT * SCALE_KIND_COUNT> buildScaleTables() {
+    std::array<ScaleTable, TONIC_COUNT * SCALE_KIND_COUNT> tables{};
+    for (size_t t = 0; t < TONIC_COUNT; t++) {
+        for (size_t s = 0; s < SCALE_KIND_COUNT; s++) {
+            tables[t * SCALE_KIND_COUNT + s] = buildScaleTable(TONIC_SPELLINGS[t], s);
+        }
+    }
+    return tables;
+}
+
+constexpr std::array<ScaleTable, TONIC_COUNT * SCALE_KIND_COUNT> SCALE_TABLES = buildScaleTables();
+
+static_assert(SCALE_TABLES[0].semitones[6] == 11, "C major degree 7 is B");
+static_assert(SCALE_TABLES[10 * SCALE_KIND_COUNT].semitones[6] == 6, "G major degree 7 is F#");
+static_assert(SCALE_TABLES[13 * SCALE_KIND_COUNT + 2].semitones[6] == 8, "A harmonic minor degree 7 is G#");
+
+// ============================================
+// Lookup
+// ============================================
+// Index into TONIC_SPELLINGS, -1 if `key` is not one of them
+inline int tonicIndex(std::string_view key) {
+    for (size_t t = 0; t < TONIC_COUNT; t++) {
+        if (key == TONIC_SPELLINGS[t].name) return static_cast<int>(t);
+    }
+    return -1;
+}
+
+// -1 if `scale` is not a supported scale name
+inline int scaleIndex(std::string_view scale) {
+    if (scale == "Major") return static_cast<int>(ScaleKind::MAJOR);
+    if (scale == "Minor") return static_cast<int>(ScaleKind::MINOR);
+    if (scale == "HarmonicMinor") return static_cast<int>(ScaleKind::HARMONIC_MINOR);
+    return -1;
+}
+
+inline const ScaleTable& scaleTable(int tonic, int scale) {
+    return SCALE_TABLES[static_cast<size_t>(tonic) * SCALE_KIND_COUNT + static_cast<size_t>(scale)];
+}
+
+// MIDI note number of `degree` (1-7) raised or lowered by `accidental`
+// semitones, in `octave` (the hand's octave plus any ^ shift)
+constexpr int midiNote(const ScaleTable& table, int degree, int accidental, int octave) {
+    return (octave + 1) * 12 + table.semitones[degree - 1] + accidental;
+}
+
+#endif
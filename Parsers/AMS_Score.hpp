@@ -0,0 +1,309 @@
+#ifndef AMS_SCORE_HPP
+#define AMS_SCORE_HPP
+
+// AMS Score - compact in-memory representation of parsed hands
+//
+// A Note packs into 8 bytes: accidental, articulation and dynamic are
+// one-byte enums and the duration is an integer tick count. Hands do not
+// store Note objects; they keep each field in its own flat array, with
+// chord and chunk boundaries as offsets, so a hand is a handful of
+// contiguous allocations however many notes it has.
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "AMS_Notes.hpp"
+
+enum class Accidental : uint8_t { NONE, SHARP, FLAT };
+enum class Articulation : uint8_t { NONE, STACCATO, LEGATO, ACCENT, FERMATA };
+enum class Dynamic : uint8_t { NONE, PP, P, MP, MF, F, FF };
+
+struct Note {
+    uint16_t ticks;             // duration
+    int8_t degree;              // 1-7, 0 when unset
+    int8_t octave_shift;        // ^1, ^-1, etc.
+    Accidental accidental;
+    Articulation articulation;
+    Dynamic dynamic;
+    uint8_t is_dotted : 1;
+    uint8_t is_rest : 1;
+
+    Note() : ticks(TICKS_PER_BEAT), degree(0), octave_shift(0), accidental(Accidental::NONE),
+             articulation(Articulation::NONE), dynamic(Dynamic::NONE), is_dotted(0), is_rest(0) {}
+};
+
+static_assert(sizeof(Note) == 8, "Note is expected to pack into 8 bytes");
+
+// A hand is stored column-wise in one arena. Per-note columns hold the
+// degree, octave shift and packed flags; per-chord columns hold the tick
+// count and dotted flag. Chord c owns notes [chord_starts[c], chord_starts[c+1])
+// and chunk k owns chords [chunk_starts[k], chunk_starts[k+1]). Every note
+// of a chord shares the chord's duration, so it is only stored once.
+struct Hand {
+    // Per note
+    std::vector<int8_t> degrees;
+    std::vector<int8_t> octave_shifts;
+    std::vector<uint16_t> flags;
+
+    // Per chord
+    std::vector<uint16_t> ticks;
+    std::vector<uint8_t> dotted;
+    std::vector<uint32_t> chord_starts;  // one more entry than there are chords
+
+    // Per chunk (chunks are separated by ||)
+    std::vector<uint32_t> chunk_starts;  // one more entry than there are chunks
+
+    Hand() : chord_starts(1, 0), chunk_starts(1, 0) {}
+
+    size_t chunkCount() const { return chunk_starts.size() - 1; }
+    size_t chordCount() const { return ticks.size(); }
+    size_t noteCount() const { return degrees.size(); }
+    bool empty() const { return chunkCount() == 0; }
+
+    // Building: add a chord's notes, close the chord, and close the chunk
+    // once all its chords are in. Chunks without chords are dropped.
+    void addNote(const Note& note) {
+        degrees.push_back(note.degree);
+        octave_shifts.push_back(note.octave_shift);
+        flags.push_back(packFlags(note));
+    }
+
+    void endChord(uint16_t chord_ticks, bool is_dotted) {
+        ticks.push_back(chord_ticks);
+        dotted.push_back(is_dotted);
+        chord_starts.push_back(static_cast<uint32_t>(degrees.size()));
+    }
+
+    void endChunk() {
+        if (ticks.size() > chunk_starts.back()) {
+            chunk_starts.push_back(static_cast<uint32_t>(ticks.size()));
+        }
+    }
+
+    // Appends every chord of `fragment`. The fragment's chunk breaks are
+    // kept, except after its last chunk: what follows continues that chunk
+    // until the next separator, as if the fragment's text stood here.
+    void append(const Hand& fragment) {
+        if (fragment.empty()) return;
+
+        uint32_t note_offset = static_cast<uint32_t>(degrees.size());
+        uint32_t chord_offset = static_cast<uint32_t>(ticks.size());
+
+        degrees.insert(degrees.end(), fragment.degrees.begin(), fragment.degrees.end());
+        octave_shifts.insert(octave_shifts.end(), fragment.octave_shifts.begin(), fragment.octave_shifts.end());
+        flags.insert(flags.end(), fragment.flags.begin(), fragment.flags.end());
+        ticks.insert(ticks.end(), fragment.ticks.begin(), fragment.ticks.end());
+        dotted.insert(dotted.end(), fragment.dotted.begin(), fragment.dotted.end());
+
+        chord_starts.reserve(chord_starts.size() + fragment.chordCount());
+        for (size_t c = 1; c < fragment.chord_starts.size(); c++) {
+            chord_starts.push_back(fragment.chord_starts[c] + note_offset);
+        }
+        for (size_t k = 1; k + 1 < fragment.chunk_starts.size(); k++) {
+            chunk_starts.push_back(fragment.chunk_starts[k] + chord_offset);
+        }
+    }
+
+    // Reassembles note `index`, which belongs to `chord`
+    Note note(size_t chord, size_t index) const {
+        Note n;
+        uint16_t f = flags[index];
+        n.ticks = ticks[chord];
+        n.degree = degrees[index];
+        n.octave_shift = octave_shifts[index];
+        n.accidental = static_cast<Accidental>(f & 0x3);
+        n.articulation = static_cast<Articulation>((f >> 2) & 0x7);
+        n.dynamic = static_cast<Dynamic>((f >> 5) & 0x7);
+        n.is_rest = (f >> 8) & 0x1;
+        n.is_dotted = dotted[chord];
+        return n;
+    }
+
+private:
+    // accidental: bits 0-1, articulation: bits 2-4, dynamic: bits 5-7, rest: bit 8
+    static uint16_t packFlags(const Note& note) {
+        return static_cast<uint16_t>(static_cast<unsigned>(note.accidental) |
+                                     (static_cast<unsigned>(note.articulation) << 2) |
+                                     (static_cast<unsigned>(note.dynamic) << 5) |
+                                     (static_cast<unsigned>(note.is_rest) << 8));
+    }
+};
+
+// ============================================
+// Conversions
+// ============================================
+// For output and messages only; nothing is computed in beats
+inline double ticksToBeats(uint32_t ticks) {
+    return static_cast<double>(ticks) / TICKS_PER_BEAT;
+}
+
+inline Accidental accidentalFromText(std::string_view text) {
+    if (text == "#") return Accidental::SHARP;
+    if (text == "b") return Accidental::FLAT;
+    return Accidental::NONE;
+}
+
+inline const char* accidentalText(Accidental accidental) {
+    switch (accidental) {
+        case Accidental::SHARP: return "#";
+        case Accidental::FLAT: return "b";
+        default: return "";
+    }
+}
+
+inline int accidentalSemitones(Accidental accidental) {
+    return accidental == Accidental::SHARP ? 1 : accidental == Accidental::FLAT ? -1 : 0;
+}
+
+inline Articulation articulationFromText(std::string_view text) {
+    if (text == "!") return Articulation::STACCATO;
+    if (text == "~") return Articulation::LEGATO;
+    if (text == ">") return Articulation::ACCENT;
+    if (text == "(h)") return Articulation::FERMATA;
+    return Articulation::NONE;
+}
+
+inline const char* articulationText(Articulation articulation) {
+    switch (articulation) {
+        case Articulation::STACCATO: return "!";
+        case Articulation::LEGATO: return "~";
+        case Articulation::ACCENT: return ">";
+        case Articulation::FERMATA: return "(h)";
+        default: return "";
+    }
+}
+
+// Returns false for markings outside pp..ff, leaving `dynamic` as NONE.
+inline bool dynamicFromText(std::string_view text, Dynamic& dynamic) {
+    dynamic = Dynamic::NONE;
+    if (text.empty()) return true;
+    if (text == "pp") dynamic = Dynamic::PP;
+    else if (text == "p") dynamic = Dynamic::P;
+    else if (text == "mp") dynamic = Dynamic::MP;
+    else if (text == "mf") dynamic = Dynamic::MF;
+    else if (text == "f") dynamic = Dynamic::F;
+    else if (text == "ff") dynamic = Dynamic::FF;
+    else return false;
+    return true;
+}
+
+inline const char* dynamicText(Dynamic dynamic) {
+    switch (dynamic) {
+        case Dynamic::PP: return "pp";
+        case Dynamic::P: return "p";
+        case Dynamic::MP: return "mp";
+        case Dynamic::MF: return "mf";
+        case Dynamic::F: return "f";
+        case Dynamic::FF: return "ff";
+        default: return "";
+    }
+}
+
+// Degrees and octave shifts are clamped to the int8 range, far beyond
+// anything that maps to a playable pitch.
+inline int8_t packSmallInt(int value) {
+    if (value < INT8_MIN) return INT8_MIN;
+    if (value > INT8_MAX) return INT8_MAX;
+    return static_cast<int8_t>(value);
+}
+
+inline Note packNote(const NoteText& text) {
+    Note note;
+    note.ticks = static_cast<uint16_t>(text.ticks);
+    note.degree = packSmallInt(text.degree);
+    note.octave_shift = packSmallInt(text.octave_shift);
+    note.accidental = accidentalFromText(text.accidental);
+    note.articulation = articulationFromText(text.articulation);
+    dynamicFromText(text.dynamic, note.dynamic);
+    note.is_dotted = text.is_dotted;
+    note.is_rest = text.is_rest;
+    return note;
+}
+
+// ============================================
+// Fast Decoding
+// ============================================
+// Decodes a valid note in its usual written order, R or a degree 1-7, then
+// any of #/b, ^shift, articulation, dynamic and duration, straight into a
+// Note in one pass. Returns false for anything else, including text that
+// is valid but unusual; parseNoteText + packNote then give the answer.
+// Whatever is accepted here decodes exactly as it would there.
+inline bool decodeDuration(std::string_view str, size_t i, Note& note) {
+    size_t left = str.size() - i;
+    if (left == 0) return true;
+    if (str[i] != '.') return false;
+
+    char c = left > 1 ? str[i + 1] : '\0';
+    if (left == 1) {
+        note.ticks = 3 * TICKS_PER_BEAT / 2;
+        note.is_dotted = 1;
+        return true;
+    }
+    if (left == 3 && str[i + 2] == '.' && (c == 'h' || c == 'e')) {
+        note.ticks = c == 'h' ? 3 * TICKS_PER_BEAT : 3 * TICKS_PER_BEAT / 4;
+        note.is_dotted = 1;
+        return true;
+    }
+    if (left != 2) return false;
+    switch (c) {
+        case 'h': note.ticks = 2 * TICKS_PER_BEAT; return true;
+        case 'w': note.ticks = 4 * TICKS_PER_BEAT; return true;
+        case 'e': note.ticks = TICKS_PER_BEAT / 2; return true;
+        case 's': note.ticks = TICKS_PER_BEAT / 4; return true;
+        default: return false;
+    }
+}
+
+inline bool decodeNote(std::string_view str, Note& note) {
+    note = Note();
+    if (str.empty()) return false;
+
+    if (str[0] == 'R') {
+        note.is_rest = 1;
+        return decodeDuration(str, 1, note);
+    }
+
+    if (str[0] < '1' || str[0] > '7') return false;
+    note.degree = static_cast<int8_t>(str[0] - '0');
+    size_t i = 1;
+    size_t n = str.size();
+
+    if (i < n && (str[i] == '#' || str[i] == 'b')) {
+        note.accidental = str[i] == '#' ? Accidental::SHARP : Accidental::FLAT;
+        i++;
+    }
+
+    if (i < n && str[i] == '^') {
+        i++;
+        bool negative = i < n && str[i] == '-';
+        if (negative) i++;
+        size_t start = i;
+        int shift = 0;
+        while (i < n && isDigit(str[i]) && i - start < 3) shift = shift * 10 + (str[i++] - '0');
+        if (i == start || (i < n && isDigit(str[i]))) return false;
+        note.octave_shift = packSmallInt(negative ? -shift : shift);
+    }
+
+    if (i < n) {
+        switch (str[i]) {
+            case '!': note.articulation = Articulation::STACCATO; i++; break;
+            case '~': note.articulation = Articulation::LEGATO; i++; break;
+            case '>': note.articulation = Articulation::ACCENT; i++; break;
+            case '(':
+                if (str.substr(i, 3) != "(h)") return false;
+                note.articulation = Articulation::FERMATA;
+                i += 3;
+                break;
+            default: break;
+        }
+    }
+
+    size_t start = i;
+    while (i < n && (str[i] == 'p' || str[i] == 'f' || str[i] == 'm')) i++;
+    if (i > start && !dynamicFromText(str.substr(start, i - start), note.dynamic)) return false;
+
+    return decodeDuration(str, i, note);
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef AMS_SOURCE_HPP
+#define AMS_SOURCE_HPP
+
+// AMS Source - read-only view of an .ams file
+//
+// The file is memory-mapped where the platform allows it (and read into a
+// single buffer otherwise, or when the caller asks for a copy). Only the start offset of each line is stored;
+// raw text for diagnostics and the comment-stripped, trimmed text used for
+// parsing are both sliced from the mapping on demand.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+class SourceFile {
+private:
+    const char* data;
+    size_t length;
+    bool mapped;
+    std::string buffer;                 // fallback storage when mmap is unavailable
+    std::vector<uint32_t> line_starts;  // byte offset of every line
+
+    static bool isTrimmed(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool mapFile(const std::string& filename) {
+#if !defined(_WIN32)
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return false;
+
+        ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char*>(addr);
+        length = static_cast<size_t>(st.st_size);
+        mapped = true;
+        return true;
+#else
+        (void)filename;
+        return false;
+#endif
+    }
+
+    bool readFile(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+        return true;
+    }
+
+    void indexLines() {
+        line_starts.clear();
+        if (length == 0) return;
+
+        line_starts.push_back(0);
+        const char* p = data;
+        const char* end = data + length;
+        while ((p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr) {
+            p++;
+            if (p == end) break;
+            line_starts.push_back(static_cast<uint32_t>(p - data));
+        }
+    }
+
+public:
+    SourceFile() : data(nullptr), length(0), mapped(false) {}
+    ~SourceFile() { close(); }
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    // With map false the file is always read into memory. A mapping faults
+    // on access once the file is truncated, so sources kept open while the
+    // file may be rewritten should not be mapped.
+    bool open(const std::string& filename, bool map = true) {
+        close();
+        if (!(map && mapFile(filename)) && !readFile(filename)) return false;
+
+        // Line offsets are 32-bit to keep the index compact
+        if (length > UINT32_MAX) {
+            close();
+            return false;
+        }
+
+        indexLines();
+        return true;
+    }
+
+    void close() {
+#if !defined(_WIN32)
+        if (mapped) ::munmap(const_cast<char*>(data), length);
+#endif
+        data = nullptr;
+        length = 0;
+        mapped = false;
+        buffer.clear();
+        line_starts.clear();
+    }
+
+    size_t lineCount() const { return line_starts.size(); }
+    size_t size() const { return length; }
+    bool isMapped() const { return mapped; }
+
+    // Line text exactly as written, without the line terminator
+    std::string_view rawLine(size_t index) const {
+        size_t start = line_starts[index];
+        size_t end = (index + 1 < line_starts.size()) ? line_starts[index + 1] - 1 : length;
+        if (end > start && data[end - 1] == '\n') end--;
+        return std::string_view(data + start, end - start);
+    }
+
+    // Raw bytes of lines [first, first + count), terminators included
+    std::string_view span(size_t first, size_t count) const {
+        if (count == 0 || first >= line_starts.size()) return {};
+        size_t start = line_starts[first];
+        size_t end = (first + count < line_starts.size()) ? line_starts[first + count] : length;
+        return std::string_view(data + start, end - start);
+    }
+
+    // Line text with the // comment removed and surrounding whitespace trimmed
+    std::string_view line(size_t index) const {
+        std::string_view text = rawLine(index);
+        size_t comment = text.find("//");
+        if (comment != std::string_view::npos) text = text.substr(0, comment);
+
+        size_t start = 0;
+        size_t end = text.size();
+        while (start < end && isTrimmed(text[start])) start++;
+        while (end > start && isTrimmed(text[end - 1])) end--;
+        return text.substr(start, end - start);
+    }
+};
+
+#endif
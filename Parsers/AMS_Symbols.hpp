@@ -0,0 +1,178 @@
+#ifndef AMS_SYMBOLS_HPP
+#define AMS_SYMBOLS_HPP
+
+// AMS Symbols - interned identifiers and flat tables for the parser
+//
+// Segment and macro names are interned once, when their header is seen,
+// and referred to by a dense integer Symbol from then on. Tables keyed by
+// a name are then plain vectors indexed by Symbol (SymbolMap); segment
+// ids, which are arbitrary integers, go into an open-addressing IdTable.
+// Neither does any string comparison on lookup: a SymbolPool probe only
+// compares the text of an entry whose 64-bit hash already matched.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AMS_Util.hpp"
+
+using Symbol = uint32_t;
+const Symbol NO_SYMBOL = UINT32_MAX;
+
+// ============================================
+// Symbol Pool
+// ============================================
+// Every name is stored once, back to back in one buffer. Lookups probe a
+// power-of-two slot array linearly; it is kept at most half full.
+class SymbolPool {
+private:
+    std::string text;                // every name, back to back
+    std::vector<uint32_t> starts;    // one more entry than there are symbols
+    std::vector<uint64_t> hashes;    // per symbol
+    std::vector<Symbol> slots;       // NO_SYMBOL when empty
+
+    // The slot holding `name`, or the empty slot where it would go
+    size_t probe(std::string_view name, uint64_t hash) const {
+        size_t mask = slots.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        while (slots[i] != NO_SYMBOL) {
+            Symbol s = slots[i];
+            if (hashes[s] == hash && name == view(s)) break;
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow() {
+        std::vector<Symbol> old = std::move(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, NO_SYMBOL);
+        size_t mask = slots.size() - 1;
+        for (Symbol s : old) {
+            if (s == NO_SYMBOL) continue;
+            size_t i = static_cast<size_t>(hashes[s]) & mask;
+            while (slots[i] != NO_SYMBOL) i = (i + 1) & mask;
+            slots[i] = s;
+        }
+    }
+
+public:
+    SymbolPool() : starts(1, 0) {}
+
+    size_t size() const { return hashes.size(); }
+
+    // The text of `symbol`; valid until the next intern()
+    std::string_view view(Symbol symbol) const {
+        return std::string_view(text).substr(starts[symbol], starts[symbol + 1] - starts[symbol]);
+    }
+
+    // NO_SYMBOL if `name` was never interned
+    Symbol find(std::string_view name) const {
+        if (slots.empty()) return NO_SYMBOL;
+        return slots[probe(name, hashBytes(name))];
+    }
+
+    Symbol intern(std::string_view name) {
+        if (2 * (size() + 1) > slots.size()) grow();
+
+        uint64_t hash = hashBytes(name);
+        size_t i = probe(name, hash);
+        if (slots[i] != NO_SYMBOL) return slots[i];
+
+        Symbol symbol = static_cast<Symbol>(size());
+        text.append(name.data(), name.size());
+        starts.push_back(static_cast<uint32_t>(text.size()));
+        hashes.push_back(hash);
+        slots[i] = symbol;
+        return symbol;
+    }
+};
+
+// ============================================
+// Symbol Map
+// ============================================
+// An int per symbol, -1 for symbols that were never set. clear() keeps
+// the storage, so a reparse does not reallocate it.
+class SymbolMap {
+private:
+    std::vector<int> values;
+
+public:
+    int get(Symbol symbol) const {
+        return symbol < values.size() ? values[symbol] : -1;
+    }
+
+    bool has(Symbol symbol) const { return get(symbol) != -1; }
+
+    void set(Symbol symbol, int value) {
+        if (symbol >= values.size()) values.resize(symbol + 1, -1);
+        values[symbol] = value;
+    }
+
+    void clear() { values.assign(values.size(), -1); }
+};
+
+// ============================================
+// Id Table
+// ============================================
+// int -> int, open addressing with linear probing, at most half full.
+// Values are never -1; find() returns -1 for a missing key.
+class IdTable {
+private:
+    struct Slot {
+        int key;
+        int value;  // -1: empty
+    };
+    std::vector<Slot> slots;
+    size_t count;
+
+    static size_t mix(int key) {
+        uint64_t h = static_cast<uint32_t>(key) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+
+    size_t probe(int key) const {
+        size_t mask = slots.size() - 1;
+        size_t i = mix(key) & mask;
+        while (slots[i].value != -1 && slots[i].key != key) i = (i + 1) & mask;
+        return i;
+    }
+
+    void grow() {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, Slot{0, -1});
+        for (const Slot& slot : old) {
+            if (slot.value != -1) slots[probe(slot.key)] = slot;
+        }
+    }
+
+public:
+    IdTable() : count(0) {}
+
+    int find(int key) const {
+        if (slots.empty()) return -1;
+        return slots[probe(key)].value;
+    }
+
+    bool has(int key) const { return find(key) != -1; }
+
+    void set(int key, int value) {
+        if (2 * (count + 1) > slots.size()) grow();
+        Slot& slot = slots[probe(key)];
+        if (slot.value == -1) count++;
+        slot.key = key;
+        slot.value = value;
+    }
+
+    void reserve(size_t keys) {
+        while (2 * keys > slots.size()) grow();
+    }
+
+    void clear() {
+        slots.assign(slots.size(), Slot{0, -1});
+        count = 0;
+    }
+};
+
+#endif
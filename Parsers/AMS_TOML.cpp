@@ -0,0 +1,328 @@
+// AMS TOML - TOML emitter
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "AMS_TOML.hpp"
+
+// ============================================
+// TOML Writer
+// ============================================
+// Every call writes its line(s) straight into the sink.
+class TOML {
+private:
+    OutputSink& out;
+    bool first_item = true;
+
+    void writeString(std::string_view str) {
+        out.put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < str.size(); i++) {
+            if (str[i] != '"' && str[i] != '\\') continue;
+            out.write(str.substr(start, i - start));
+            out.put('\\');
+            start = i;
+        }
+        out.write(str.substr(start));
+        out.put('"');
+    }
+
+    void separate() {
+        if (!first_item) out.write(", ");
+        first_item = false;
+    }
+
+    void name(std::string_view key) {
+        out.write(key);
+        out.write(" = ");
+    }
+
+public:
+    explicit TOML(OutputSink& out) : out(out) {}
+
+    void addComment(std::string_view comment) {
+        out.write("# ");
+        out.write(comment);
+        out.put('\n');
+    }
+
+    void addSection(std::string_view name) {
+        out.write("\n[");
+        out.write(name);
+        out.write("]\n");
+    }
+
+    void addArraySection(std::string_view name) {
+        out.write("\n[[");
+        out.write(name);
+        out.write("]]\n");
+    }
+
+    void addString(std::string_view key, std::string_view value) {
+        name(key);
+        writeString(value);
+        out.put('\n');
+    }
+
+    void addNumber(std::string_view key, int value) {
+        name(key);
+        out.writeInt(value);
+        out.put('\n');
+    }
+
+    void addNumber(std::string_view key, double value) {
+        name(key);
+        out.writeFixed(value, 2);
+        out.put('\n');
+    }
+
+    void addBool(std::string_view key, bool value) {
+        name(key);
+        out.write(value ? "true\n" : "false\n");
+    }
+
+    void addStringArray(std::string_view key, const std::string_view* values, size_t count) {
+        startArray(key);
+        for (size_t i = 0; i < count; i++) addItem(values[i]);
+        endArray();
+    }
+
+    // key = [item, item, ...] on one line
+    void startArray(std::string_view key) {
+        name(key);
+        out.put('[');
+        first_item = true;
+    }
+
+    void endArray() { out.write("]\n"); }
+
+    void addItem(std::string_view value) {
+        separate();
+        writeString(value);
+    }
+
+    void addItem(long long value) {
+        separate();
+        out.writeInt(value);
+    }
+
+    void addItem(double value) {
+        separate();
+        out.writeFixed(value, 2);
+    }
+
+    void addItem(bool value) {
+        separate();
+        out.write(value ? "true" : "false");
+    }
+};
+
+// ============================================
+// Emitter
+// ============================================
+static void segmentToTOML(TOML& toml, const MapBlock& map_block, const Segment& seg) {
+    // Left hand
+    int chunk_idx = 0;
+    const Hand& left = seg.left;
+    for (size_t k = 0; k < left.chunkCount(); k++) {
+        for (size_t c = left.chunk_starts[k]; c < left.chunk_starts[k + 1]; c++) {
+            toml.addArraySection("segments.left.chords");
+            toml.addNumber("chunk", chunk_idx);
+            toml.addNumber("duration", ticksToBeats(left.ticks[c]));
+            toml.addBool("is_dotted", left.dotted[c]);
+            
+            for (size_t n = left.chord_starts[c]; n < left.chord_starts[c + 1]; n++) {
+                Note note = left.note(c, n);
+                if (!note.is_rest && note.degree > 0) {
+                    toml.addArraySection("segments.left.chords.notes");
+                    toml.addBool("is_rest", note.is_rest);
+                    toml.addNumber("degree", note.degree);
+                    toml.addString("accidental", accidentalText(note.accidental));
+                    toml.addNumber("octave_shift", note.octave_shift);
+                    if (map_block.hasPitch(note.degree)) {
+                        toml.addString("pitch", map_block.pitch(note.degree));
+                    }
+                    toml.addNumber("duration", ticksToBeats(note.ticks));
+                    toml.addBool("is_dotted", note.is_dotted);
+                    toml.addString("articulation", articulationText(note.articulation));
+                    toml.addString("dynamic", dynamicText(note.dynamic));
+                }
+            }
+        }
+        chunk_idx++;
+    }
+    
+    // Right hand
+    chunk_idx = 0;
+    const Hand& right = seg.right;
+    for (size_t k = 0; k < right.chunkCount(); k++) {
+        for (size_t c = right.chunk_starts[k]; c < right.chunk_starts[k + 1]; c++) {
+            toml.addArraySection("segments.right.chords");
+            toml.addNumber("chunk", chunk_idx);
+            toml.addNumber("duration", ticksToBeats(right.ticks[c]));
+            toml.addBool("is_dotted", right.dotted[c]);
+            
+            for (size_t n = right.chord_starts[c]; n < right.chord_starts[c + 1]; n++) {
+                Note note = right.note(c, n);
+                if (!note.is_rest && note.degree > 0) {
+                    toml.addArraySection("segments.right.chords.notes");
+                    toml.addBool("is_rest", note.is_rest);
+                    toml.addNumber("degree", note.degree);
+                    toml.addString("accidental", accidentalText(note.accidental));
+                    toml.addNumber("octave_shift", note.octave_shift);
+                    if (map_block.hasPitch(note.degree)) {
+                        toml.addString("pitch", map_block.pitch(note.degree));
+                    }
+                    toml.addNumber("duration", ticksToBeats(note.ticks));
+                    toml.addBool("is_dotted", note.is_dotted);
+                    toml.addString("articulation", articulationText(note.articulation));
+                    toml.addString("dynamic", dynamicText(note.dynamic));
+                } else if (note.is_rest) {
+                    toml.addArraySection("segments.right.chords.notes");
+                    toml.addBool("is_rest", true);
+                    toml.addNumber("duration", ticksToBeats(note.ticks));
+                    toml.addBool("is_dotted", note.is_dotted);
+                }
+            }
+        }
+        chunk_idx++;
+    }
+}
+
+// ============================================
+// Compact Layout
+// ============================================
+// A hand's columns, as in Hand: chunk_starts and chord_starts hold one
+// more entry than there are chunks and chords. The other columns have one
+// entry per chord (durations, dotted) or per note (degrees, ...).
+template <typename Value>
+static void addNoteColumn(TOML& toml, std::string_view key, const Hand& hand, Value value) {
+    toml.startArray(key);
+    for (size_t c = 0; c < hand.chordCount(); c++) {
+        for (size_t n = hand.chord_starts[c]; n < hand.chord_starts[c + 1]; n++) {
+            toml.addItem(value(hand.note(c, n)));
+        }
+    }
+    toml.endArray();
+}
+
+template <typename Test>
+static bool anyNote(const Hand& hand, Test test) {
+    for (size_t c = 0; c < hand.chordCount(); c++) {
+        for (size_t n = hand.chord_starts[c]; n < hand.chord_starts[c + 1]; n++) {
+            if (test(hand.note(c, n))) return true;
+        }
+    }
+    return false;
+}
+
+static void handToCompactTOML(TOML& toml, const char* section, const Hand& hand) {
+    toml.addSection(section);
+
+    toml.startArray("chunk_starts");
+    for (uint32_t start : hand.chunk_starts) toml.addItem(static_cast<long long>(start));
+    toml.endArray();
+
+    toml.startArray("durations");
+    for (uint16_t ticks : hand.ticks) toml.addItem(ticksToBeats(ticks));
+    toml.endArray();
+
+    bool any_dotted = false;
+    for (uint8_t dotted : hand.dotted) any_dotted |= dotted != 0;
+    if (any_dotted) {
+        toml.startArray("dotted");
+        for (uint8_t dotted : hand.dotted) toml.addItem(dotted != 0);
+        toml.endArray();
+    }
+
+    toml.startArray("chord_starts");
+    for (uint32_t start : hand.chord_starts) toml.addItem(static_cast<long long>(start));
+    toml.endArray();
+
+    addNoteColumn(toml, "degrees", hand, [](const Note& note) { return static_cast<long long>(note.degree); });
+
+    // Columns left out are all false, "" or 0
+    if (anyNote(hand, [](const Note& note) { return note.is_rest != 0; })) {
+        addNoteColumn(toml, "rests", hand, [](const Note& note) { return note.is_rest != 0; });
+    }
+    if (anyNote(hand, [](const Note& note) { return note.accidental != Accidental::NONE; })) {
+        addNoteColumn(toml, "accidentals", hand,
+                      [](const Note& note) { return std::string_view(accidentalText(note.accidental)); });
+    }
+    if (anyNote(hand, [](const Note& note) { return note.octave_shift != 0; })) {
+        addNoteColumn(toml, "octave_shifts", hand,
+                      [](const Note& note) { return static_cast<long long>(note.octave_shift); });
+    }
+    if (anyNote(hand, [](const Note& note) { return note.articulation != Articulation::NONE; })) {
+        addNoteColumn(toml, "articulations", hand,
+                      [](const Note& note) { return std::string_view(articulationText(note.articulation)); });
+    }
+    if (anyNote(hand, [](const Note& note) { return note.dynamic != Dynamic::NONE; })) {
+        addNoteColumn(toml, "dynamics", hand,
+                      [](const Note& note) { return std::string_view(dynamicText(note.dynamic)); });
+    }
+}
+
+static void writeSegment(TOML& toml, const MapBlock& map_block, const Segment& seg, bool compact) {
+    toml.addArraySection("segments");
+    toml.addNumber("id", seg.id);
+    toml.addString("name", seg.name);
+    toml.addNumber("tempo", seg.tempo);
+
+    if (compact) {
+        handToCompactTOML(toml, "segments.left", seg.left);
+        handToCompactTOML(toml, "segments.right", seg.right);
+    } else {
+        segmentToTOML(toml, map_block, seg);
+    }
+}
+
+void writeTOML(const Score& score, OutputSink& out, TOMLLayout layout, unsigned workers) {
+    const Metadata& metadata = score.metadata;
+    const MapBlock& map_block = score.map_block;
+
+    TOML toml(out);
+    
+    bool compact = layout == TOMLLayout::COMPACT;
+    toml.addComment("AMS to TOML - Generated by AMS Parser v3.0-Beta");
+    toml.addComment(metadata.title);
+    
+    // Metadata section
+    toml.addSection("metadata");
+    toml.addString("version", "3.0-Beta");
+    toml.addString("title", metadata.title);
+    toml.addString("composer", metadata.composer);
+    toml.addString("key", metadata.key);
+    toml.addNumber("tempo", metadata.tempo);
+    toml.addString("time_signature", metadata.time_signature);
+    toml.addNumber("difficulty", metadata.difficulty);
+    if (compact) toml.addString("layout", "compact");
+    
+    // Map section
+    toml.addSection("map");
+    toml.addString("key", map_block.key);
+    toml.addString("scale", map_block.scale);
+    
+    std::string_view note_mapping[7];
+    for (int i = 1; i <= 7; i++) {
+        note_mapping[i - 1] = map_block.pitch(i);
+    }
+    toml.addStringArray("note_mapping", note_mapping, 7);
+    
+    // Segments, each on its own writer so they can be written in parallel
+    if (segmentNoteCount(score) < PARALLEL_EMIT_MIN_NOTES) workers = 1;
+    writeOrdered(out, score.segments.size(), workers, [&](size_t i, OutputSink& sink) {
+        TOML part(sink);
+        writeSegment(part, map_block, score.segments[i], compact);
+    });
+}
+
+std::string scoreToTOML(const Score& score, TOMLLayout layout, unsigned workers) {
+    std::string text;
+    {
+        OutputSink out(text);
+        writeTOML(score, out, layout, workers);
+    }
+    return text;
+}
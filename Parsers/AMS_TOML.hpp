@@ -0,0 +1,37 @@
+#ifndef AMS_TOML_HPP
+#define AMS_TOML_HPP
+
+// AMS TOML - TOML emitter over the shared IR
+//
+// writeTOML streams the document into a sink section by section;
+// scoreToTOML collects the same bytes into a string.
+//
+// The full layout gives every chord and note its own [[...]] table. The
+// compact layout (metadata.layout = "compact") stores each hand as
+// parallel arrays, the way Hand holds it in memory:
+//
+//     [segments.left]
+//     chunk_starts = [0, 2]       # chunk k: chords chunk_starts[k] up to chunk_starts[k + 1]
+//     durations = [4.00, 2.00]    # beats, per chord
+//     chord_starts = [0, 2, 3]    # chord c: notes chord_starts[c] up to chord_starts[c + 1]
+//     degrees = [1, 3, 5]         # per note
+//
+// dotted (per chord) and rests, accidentals, octave_shifts, articulations
+// and dynamics (per note) follow only when some entry is not false, "" or
+// 0. Pitches are left out: they are map.note_mapping[degree - 1]. Every
+// note of every hand is kept, so the Score can be rebuilt exactly.
+
+#include <string>
+
+#include "AMS_IR.hpp"
+#include "AMS_Output.hpp"
+
+enum class TOMLLayout { FULL, COMPACT };
+
+// Segments are rendered on up to `workers` threads (0: one per hardware
+// thread) when the score is large enough; the output is the same.
+void writeTOML(const Score& score, OutputSink& out, TOMLLayout layout = TOMLLayout::FULL, unsigned workers = 1);
+
+std::string scoreToTOML(const Score& score, TOMLLayout layout = TOMLLayout::FULL, unsigned workers = 1);
+
+#endif
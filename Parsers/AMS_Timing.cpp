@@ -0,0 +1,99 @@
+// AMS Timing - bulk tick arithmetic over a hand's chord columns
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "AMS_Timing.hpp"
+
+// ============================================
+// Running Sum
+// ============================================
+#if defined(__SSE2__)
+// Inclusive prefix sum of four 32-bit lanes
+static inline __m128i scanLanes(__m128i x) {
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    return x;
+}
+#endif
+
+// running[0] = 0, running[i + 1] = ticks[0] + ... + ticks[i]. The sums wrap
+// modulo 2^32, which keeps every difference of two entries exact as long
+// as the span itself fits in 32 bits.
+static void runningTicks(const uint16_t* ticks, size_t count, uint32_t* running) {
+    running[0] = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Eight chords per step: widen to two 4 x uint32 halves, scan each
+    // half in-register and carry the last lane into the next half.
+    const __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ticks + i));
+        __m128i lo = _mm_add_epi32(scanLanes(_mm_unpacklo_epi16(v, zero)), carry);
+        carry = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i hi = _mm_add_epi32(scanLanes(_mm_unpackhi_epi16(v, zero)), carry);
+        carry = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 3, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(running + i + 1), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(running + i + 5), hi);
+    }
+#endif
+
+    uint32_t total = running[i];
+    for (; i < count; i++) {
+        total += ticks[i];
+        running[i + 1] = total;
+    }
+}
+
+// ============================================
+// Chunk Totals
+// ============================================
+void chunkTotals(const Hand& hand, std::vector<uint32_t>& totals) {
+    std::vector<uint32_t> running(hand.chordCount() + 1);
+    runningTicks(hand.ticks.data(), hand.chordCount(), running.data());
+
+    size_t chunks = hand.chunkCount();
+    const uint32_t* starts = hand.chunk_starts.data();
+    totals.resize(chunks);
+    for (size_t k = 0; k < chunks; k++) {
+        totals[k] = running[starts[k + 1]] - running[starts[k]];
+    }
+}
+
+// ============================================
+// Alignment
+// ============================================
+void mismatchedChunks(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right,
+                      std::vector<size_t>& mismatches) {
+    mismatches.clear();
+    size_t common = std::min(left.size(), right.size());
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Four chunks per compare; only a block with a difference is looked at
+    // lane by lane.
+    for (; i + 4 <= common; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left.data() + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right.data() + i));
+        int equal = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+        if (equal == 0xF) continue;
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(equal & (1 << lane))) mismatches.push_back(i + lane);
+        }
+    }
+#endif
+
+    for (; i < common; i++) {
+        if (left[i] != right[i]) mismatches.push_back(i);
+    }
+
+    const std::vector<uint32_t>& longer = left.size() > right.size() ? left : right;
+    for (; i < longer.size(); i++) {
+        if (longer[i] != 0) mismatches.push_back(i);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef AMS_TIMING_HPP
+#define AMS_TIMING_HPP
+
+// AMS Timing - bulk tick arithmetic over a hand's chord columns
+//
+// Chunk totals are taken from one running sum over the hand's contiguous
+// per-chord tick column rather than chunk by chunk, so the cost does not
+// depend on how short the chunks are. The running sum and the LEFT/RIGHT
+// comparison use SSE2 where it is available (every x86-64 target) and a
+// plain loop elsewhere; both give the same results.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AMS_Score.hpp"
+
+// Tick total of every chunk of `hand`, one entry per chunk.
+void chunkTotals(const Hand& hand, std::vector<uint32_t>& totals);
+
+// Every chunk index whose totals differ, in ascending order. A chunk that
+// only one hand has counts as 0 ticks in the other.
+void mismatchedChunks(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right,
+                      std::vector<size_t>& mismatches);
+
+#endif
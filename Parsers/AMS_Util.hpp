@@ -0,0 +1,70 @@
+#ifndef AMS_UTIL_HPP
+#define AMS_UTIL_HPP
+
+// AMS Util - small string helpers shared by the library and the converters
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+
+inline std::string trim(std::string_view str) {
+    size_t start = str.find_first_not_of(" \t\n\r");
+    size_t end = str.find_last_not_of(" \t\n\r");
+    return (start == std::string_view::npos) ? "" : std::string(str.substr(start, end - start + 1));
+}
+
+inline std::vector<std::string> split(const std::string& str, char delim) {
+    std::vector<std::string> result;
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, delim)) {
+        result.push_back(trim(item));
+    }
+    return result;
+}
+
+inline bool startsWith(std::string_view str, std::string_view prefix) {
+    return str.size() >= prefix.size() && str.substr(0, prefix.size()) == prefix;
+}
+
+inline std::string replaceExtension(const std::string& filename, const std::string& new_ext) {
+    size_t last_dot = filename.find_last_of('.');
+    size_t last_slash = filename.find_last_of("/\\");
+
+    if (last_dot == std::string::npos || (last_slash != std::string::npos && last_dot < last_slash)) {
+        return filename + new_ext;
+    }
+
+    return filename.substr(0, last_dot) + new_ext;
+}
+
+// Fast 64-bit hash of a byte range, eight bytes per step. Not
+// cryptographic: it is only used to tell whether source text changed.
+inline uint64_t hashBytes(std::string_view data, uint64_t seed = 0) {
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = seed ^ (data.size() * k);
+    size_t i = 0;
+
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = (h ^ (word * k)) * k;
+        h = (h << 31) | (h >> 33);
+    }
+
+    if (i < data.size()) {
+        uint64_t tail = 0;
+        std::memcpy(&tail, data.data() + i, data.size() - i);
+        h = (h ^ (tail * k)) * k;
+    }
+
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+#endif
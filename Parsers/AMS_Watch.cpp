@@ -0,0 +1,163 @@
+// AMS Watch - inotify-driven recompilation
+
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "AMS_Watch.hpp"
+#include "AMS_Parser.hpp"
+
+#if defined(__linux__)
+
+struct WatchedFile {
+    std::string path;
+    std::string dir;
+    std::string name;
+    std::unique_ptr<AMSParser> parser;
+};
+
+typedef std::chrono::steady_clock WatchClock;
+
+static std::string millisecondsSince(WatchClock::time_point start, WatchClock::time_point end) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f", std::chrono::duration<double, std::milli>(end - start).count());
+    return text;
+}
+
+// Parses (or re-parses) one file and rewrites its outputs
+static void recompile(WatchedFile& file, const std::vector<OutputFormat>& formats, bool initial) {
+    WatchClock::time_point start = WatchClock::now();
+
+    bool ok;
+    if (!file.parser) {
+        file.parser.reset(new AMSParser(file.path, false));
+        ok = file.parser->parse();
+    } else {
+        ok = file.parser->reparse();
+    }
+    WatchClock::time_point parsed = WatchClock::now();
+
+    if (!ok) {
+        file.parser->printErrors(std::cerr);
+        std::cerr << "✗ " << file.path << " has errors (parse " << millisecondsSince(start, parsed) << " ms)\n" << std::endl;
+        return;
+    }
+
+    bool written = true;
+    for (const auto& result : emitTargets(file.parser->getScore(), file.path, formats)) {
+        if (!result.written) {
+            std::cerr << "✗ ERROR: Could not write to file: " << result.filename << std::endl;
+            written = false;
+        }
+    }
+    WatchClock::time_point emitted = WatchClock::now();
+    if (!written) return;
+
+    std::cout << "✓ " << file.path << (initial ? " compiled in " : " recompiled in ")
+              << millisecondsSince(start, emitted) << " ms (parse " << millisecondsSince(start, parsed) << " ms";
+    if (!initial) {
+        std::cout << ", " << file.parser->reusedBlockCount() << "/" << file.parser->blockCount() << " blocks reused";
+    }
+    std::cout << "; emit " << millisecondsSince(parsed, emitted) << " ms)" << std::endl;
+}
+
+int watchFiles(const std::vector<std::string>& inputs, const std::vector<OutputFormat>& formats) {
+    std::vector<std::string> paths = expandInputs(inputs);
+    if (paths.empty()) {
+        std::cerr << "✗ No .ams files matched the given inputs" << std::endl;
+        return 1;
+    }
+
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "✗ ERROR: inotify unavailable: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // Directories are watched rather than the files themselves: editors
+    // often save by writing a temporary file and renaming it over the
+    // original, which would drop a watch on the old inode.
+    std::vector<WatchedFile> files(paths.size());
+    std::map<int, std::vector<size_t>> watched_dirs;  // watch descriptor -> files
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::filesystem::path path(paths[i]);
+        files[i].path = paths[i];
+        files[i].dir = path.has_parent_path() ? path.parent_path().string() : ".";
+        files[i].name = path.filename().string();
+
+        int wd = ::inotify_add_watch(fd, files[i].dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            std::cerr << "✗ ERROR: Cannot watch " << files[i].dir << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return 1;
+        }
+        watched_dirs[wd].push_back(i);
+    }
+
+    for (auto& file : files) recompile(file, formats, true);
+    std::cout << "\nWatching " << files.size() << " file(s) for changes (Ctrl+C to stop)\n" << std::endl;
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    while (true) {
+        std::vector<bool> changed(files.size(), false);
+
+        // Block for the first event, then drain whatever else one save
+        // produced so each file is compiled once per save.
+        int timeout = -1;
+        while (true) {
+            pollfd pfd = {fd, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, timeout);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) break;
+
+            ssize_t length = ::read(fd, buffer, sizeof(buffer));
+            if (length < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "✗ ERROR: inotify read failed: " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                return 1;
+            }
+
+            for (char* p = buffer; p < buffer + length; ) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+                if (event->len == 0) continue;
+
+                auto dir = watched_dirs.find(event->wd);
+                if (dir == watched_dirs.end()) continue;
+                for (size_t i : dir->second) {
+                    if (files[i].name == event->name) changed[i] = true;
+                }
+            }
+            timeout = 0;
+        }
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (changed[i]) recompile(files[i], formats, false);
+        }
+    }
+}
+
+#else
+
+int watchFiles(const std::vector<std::string>& inputs, const std::vector<OutputFormat>& formats) {
+    (void)inputs;
+    (void)formats;
+    std::cerr << "✗ ERROR: --watch needs inotify and is only available on Linux" << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef AMS_WATCH_HPP
+#define AMS_WATCH_HPP
+
+// AMS Watch - recompile on save
+//
+// Every input is compiled once, then its directory is watched with
+// inotify. When an editor writes or renames a watched .ams file into
+// place, that file's parser runs reparse(), so only the changed blocks
+// are parsed again. Then the requested outputs are rewritten. The time
+// each recompile took is printed, split into parse and emit.
+
+#include <string>
+#include <vector>
+
+#include "AMS_Driver.hpp"
+
+// Runs until interrupted. Returns a process exit code if watching cannot
+// start (no inputs, or the platform has no inotify).
+int watchFiles(const std::vector<std::string>& inputs, const std::vector<OutputFormat>& formats);
+
+#endif